@@ -14,6 +14,10 @@ namespace peddle {
 MicroInstruction Peddle::actionFunc[256] = { };
 const char *Peddle::mnemonic[256] = { };
 AddressingMode Peddle::addressingMode[256] = { };
+MemAccess Peddle::memAccess[256] = { };
+
+// Fill the lookup tables at program start, so they are usable without a CPU
+bool Peddle::tablesInitialized = (registerInstructions(), true);
 
 Peddle::Peddle()
 {
@@ -26,8 +30,11 @@ Peddle::Peddle()
      */
     id = counter++;
 
-    // Initialize the microinstruction lookup table
+    // Initialize the lookup tables (in case of a static CPU in another unit)
     registerInstructions();
+
+    // Precompute the disassembler output (requires the lookup tables)
+    disassembler.updateTables();
 }
 
 Peddle::~Peddle()
@@ -193,6 +200,7 @@ Peddle::setPWithoutB(u8 p)
 
 #include "PeddleInit_cpp.h"
 #include "PeddleExec_cpp.h"
+#include "PeddleFusion_cpp.h"
 #include "PeddleMemory_cpp.h"
 
 }
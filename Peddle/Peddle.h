@@ -11,6 +11,20 @@
 #include "PeddleTypes.h"
 #include "PeddleDisassembler.h"
 #include "PeddleDebugger.h"
+#include "PeddleProfiler.h"
+#include "PeddleCallGraph.h"
+#include "PeddleSampler.h"
+#include "PeddleCoverage.h"
+#include "PeddleJournal.h"
+#include "PeddlePublisher.h"
+#include "PeddleCommandQueue.h"
+#include "PeddleAnalyzer.h"
+#include "PeddleXrefs.h"
+#include "PeddleBoundaries.h"
+#include "PeddleStats.h"
+#include "PeddleFusion.h"
+#include "PeddleTraps.h"
+#include "PeddleLoops.h"
 #include "PeddleUtils.h"
 
 namespace peddle {
@@ -21,6 +35,22 @@ class Peddle {
     friend class Disassembler;
     friend class Breakpoints;
     friend class Watchpoints;
+    friend class Triggers;
+    friend class Profiler;
+    friend class CallGraph;
+    friend class Sampler;
+    friend class Coverage;
+    friend class Journal;
+    friend class Publisher;
+    friend class CommandQueue;
+    friend class Analyzer;
+    friend class CrossReferences;
+    friend class BoundaryIndex;
+    friend class Statistics;
+    friend class Fusion;
+    friend class Traps;
+    friend class LoopAccelerator;
+    friend class GdbServer;
 
     //
     // Static lookup tables
@@ -37,6 +67,14 @@ public:
     // Table storing the adressing mode for each opcode
     static AddressingMode addressingMode[256];
 
+    // Table storing the kind of memory access performed by each opcode
+    static MemAccess memAccess[256];
+
+private:
+
+    // Indicates that the tables have been initialized at program start
+    static bool tablesInitialized;
+
 
     //
     // Configuration
@@ -59,6 +97,20 @@ public:
 
     Debugger debugger = Debugger(*this);
     Disassembler disassembler = Disassembler(*this);
+    Profiler profiler = Profiler(*this);
+    CallGraph callGraph = CallGraph(*this);
+    Sampler sampler = Sampler(*this);
+    Coverage coverage = Coverage(*this);
+    Journal journal = Journal(*this);
+    Publisher publisher = Publisher(*this);
+    CommandQueue commands = CommandQueue(*this);
+    Analyzer analyzer = Analyzer(*this);
+    CrossReferences xrefs = CrossReferences(*this);
+    BoundaryIndex boundaries = BoundaryIndex(*this);
+    Statistics stats = Statistics(*this);
+    Fusion fusion = Fusion(*this);
+    Traps traps = Traps(*this);
+    LoopAccelerator loops = LoopAccelerator(*this);
 
 
     //
@@ -184,15 +236,15 @@ public:
 private:
 
     // Registers the instruction set
-    void registerInstructions();
-    void registerLegalInstructions();
-    void registerIllegalInstructions();
+    static void registerInstructions();
+    static void registerLegalInstructions();
+    static void registerIllegalInstructions();
 
     // Registers a single instruction
-    void registerCallback(u8 opcode,
-                          const char *mnemonic,
-                          AddressingMode mode,
-                          MicroInstruction mInstr);
+    static void registerCallback(u8 opcode,
+                                 const char *mnemonic,
+                                 AddressingMode mode,
+                                 MicroInstruction mInstr);
 
 
     //
@@ -273,6 +325,13 @@ protected:
     // Called after the last microcycle has been completed
     template <CPURevision C> void done();
 
+    // Executes a fused instruction pair if possible and returns the number of
+    // completed instructions (PeddleFusion_cpp)
+    template <CPURevision C> int executeFused();
+
+    // Executes an instruction whose opcode has been fetched
+    template <CPURevision C> void executeFast(u8 opcode);
+
 
     //
     // Handling interrupts and the Ready line
@@ -350,7 +409,12 @@ private:
 
 private:
 
+    template <CPURevision C> u8 fetchOpcode(u16 addr);
+    template <CPURevision C> u8 fetchOperand(u16 addr);
+
     template <CPURevision C> u8 read(u16 addr);
+    template <CPURevision C> u8 readIndexed(u16 addr);
+    template <CPURevision C> u8 readDummy(u16 addr);
     template <CPURevision C> u8 readZeroPage(u8 addr);
     template <CPURevision C> u8 readStack(u8 sp);
 
@@ -406,6 +470,8 @@ protected:
 
     // State delegates
     virtual void cpuDidJam() { }
+    virtual void cpuDidSuspend() { }
+    virtual void cpuDidResume() { }
 
     // Exception delegates
     virtual void irqWillTrigger() { }
@@ -419,6 +485,9 @@ protected:
     virtual void instructionLogged() const { }
     virtual void jumpedTo(u16 addr) const { }
 
+    // Trap delegate (returns the address to continue at)
+    virtual u16 trapReached(u16 addr, isize id) { return addr; }
+
 
     //
     // Operating the Arithmetical Logical Unit (ALU)
@@ -0,0 +1,298 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <algorithm>
+#include <cstring>
+
+namespace peddle {
+
+Analyzer::~Analyzer()
+{
+    delete [] map;
+}
+
+void
+Analyzer::clear()
+{
+    if (map) memset(map, 0, 65536);
+    blocks.clear();
+}
+
+bool
+Analyzer::isValid(u8 opcode) const
+{
+    auto mnemonic = cpu.mnemonic[opcode];
+
+    // JAM opcodes are registered with a placeholder mnemonic
+    if (cpu.actionFunc[opcode] == JAM) return false;
+
+    // Illegal opcodes are marked with an asterisk
+    return followIllegal || mnemonic[3] != '*';
+}
+
+void
+Analyzer::analyze()
+{
+    if (!map) map = new u8[65536];
+    clear();
+
+    // Take a snapshot of the address space
+    u8 *mem = new u8[65536 + 2];
+    for (isize i = 0; i < 65536; i++) mem[i] = cpu.readDasm(u16(i));
+    mem[65536] = mem[0];
+    mem[65537] = mem[1];
+
+    std::vector<u16> worklist;
+
+    auto push = [&](i32 addr, u8 bits) {
+
+        map[u16(addr)] |= ANALYSIS_LEADER | bits;
+        worklist.push_back(u16(addr));
+    };
+
+    // Seed the analysis with the vectors and the user-supplied entry points
+    push(LO_HI(mem[0xFFFC], mem[0xFFFD]), ANALYSIS_CALLED);
+    push(LO_HI(mem[0xFFFE], mem[0xFFFF]), ANALYSIS_CALLED);
+    push(LO_HI(mem[0xFFFA], mem[0xFFFB]), ANALYSIS_CALLED);
+    for (auto &entry : entries) push(entry, ANALYSIS_CALLED);
+
+    while (!worklist.empty()) {
+
+        u16 addr = worklist.back();
+        worklist.pop_back();
+
+        while (true) {
+
+            // Stop if the instruction has been decoded before
+            if (map[addr] & ANALYSIS_OPCODE) break;
+
+            u8 opcode = mem[addr];
+            if (!isValid(opcode)) { map[addr] |= ANALYSIS_INVALID; break; }
+
+            // Stop if the instruction overlaps with another one
+            isize len = cpu.getLengthOfInstruction(opcode);
+            bool overlap = map[addr] & ANALYSIS_OPERAND;
+            for (isize i = 1; i < len; i++) {
+                if (map[u16(addr + i)] & (ANALYSIS_OPCODE | ANALYSIS_OPERAND)) overlap = true;
+            }
+            if (overlap) { map[addr] |= ANALYSIS_CONFLICT; break; }
+
+            map[addr] |= ANALYSIS_OPCODE;
+            for (isize i = 1; i < len; i++) map[u16(addr + i)] |= ANALYSIS_OPERAND;
+
+            u16 operand = LO_HI(mem[addr + 1], mem[addr + 2]);
+            u16 next = u16(addr + len);
+
+            if (cpu.addressingMode[opcode] == ADDR_RELATIVE) {
+
+                push(next + (i8)mem[addr + 1], 0);
+                push(next, 0);
+                break;
+            }
+
+            switch (opcode) {
+
+                case 0x4C: // JMP abs
+
+                    push(operand, 0);
+                    break;
+
+                case 0x20: // JSR
+
+                    push(operand, ANALYSIS_CALLED);
+                    push(next, 0);
+                    break;
+
+                case 0x6C: // JMP (ind)
+                case 0x60: // RTS
+                case 0x40: // RTI
+                case 0x00: // BRK
+
+                    break;
+
+                default:
+
+                    addr = next;
+                    continue;
+            }
+            break;
+        }
+    }
+
+    buildBlocks(mem);
+    delete [] mem;
+}
+
+void
+Analyzer::buildBlocks(const u8 *mem)
+{
+    BasicBlock *block = nullptr;
+
+    for (i32 addr = 0; addr < 65536; ) {
+
+        if (!(map[addr] & ANALYSIS_OPCODE)) { block = nullptr; addr++; continue; }
+
+        u8 opcode = mem[addr];
+        isize len = cpu.getLengthOfInstruction(opcode);
+        i32 next = addr + i32(len);
+
+        // Start a new block if necessary
+        if (!block || (map[addr] & ANALYSIS_LEADER)) {
+
+            blocks.push_back(BasicBlock { u16(addr), u16(addr), 0, EXIT_FALLTHROUGH, -1, -1 });
+            block = &blocks.back();
+        }
+
+        block->last = u16(addr);
+        block->count++;
+
+        // Determine if the instruction ends the block
+        bool ends = true;
+
+        if (cpu.addressingMode[opcode] == ADDR_RELATIVE) {
+
+            block->exit = EXIT_BRANCH;
+            block->target = u16(next + (i8)mem[addr + 1]);
+            block->next = u16(next);
+
+        } else if (opcode == 0x4C) {
+
+            block->exit = EXIT_JUMP;
+            block->target = LO_HI(mem[addr + 1], mem[addr + 2]);
+
+        } else if (opcode == 0x20) {
+
+            block->exit = EXIT_CALL;
+            block->target = LO_HI(mem[addr + 1], mem[addr + 2]);
+            block->next = u16(next);
+
+        } else if (opcode == 0x6C) {
+
+            block->exit = EXIT_INDIRECT;
+
+        } else if (opcode == 0x60 || opcode == 0x40) {
+
+            block->exit = EXIT_RETURN;
+
+        } else if (opcode == 0x00) {
+
+            block->exit = EXIT_INTERRUPT;
+
+        } else if (next < 65536 && (map[next] & ANALYSIS_OPCODE)) {
+
+            ends = map[next] & ANALYSIS_LEADER;
+            if (ends) { block->exit = EXIT_FALLTHROUGH; block->next = next; }
+
+        } else {
+
+            block->exit = EXIT_INVALID;
+        }
+
+        if (ends) block = nullptr;
+        addr = next;
+    }
+}
+
+isize
+Analyzer::count(u8 kinds) const
+{
+    isize result = 0;
+
+    if (map) {
+        for (isize i = 0; i < 65536; i++) if (map[i] & kinds) result++;
+    }
+    return result;
+}
+
+const BasicBlock *
+Analyzer::blockAt(u16 addr) const
+{
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), addr,
+                               [](u16 a, const BasicBlock &b) { return a < b.first; });
+
+    if (it == blocks.begin()) return nullptr;
+    --it;
+
+    // The last instruction may be up to three bytes long
+    if (addr > it->last + cpu.getLengthOfInstructionAt(it->last) - 1) return nullptr;
+    return &*it;
+}
+
+void
+Analyzer::dump(std::ostream &os) const
+{
+    static const char *exits[] = {
+
+        "fallthrough", "branch", "jump", "indirect", "call", "return", "interrupt", "invalid"
+    };
+
+    char line[96];
+
+    for (auto &block : blocks) {
+
+        snprintf(line, sizeof(line), "%04X-%04X %4ld instr  %-11s", block.first, block.last,
+                 long(block.count), exits[block.exit]);
+        os << line;
+
+        if (block.target >= 0) { snprintf(line, sizeof(line), "  -> %04X", block.target); os << line; }
+        if (block.next >= 0) { snprintf(line, sizeof(line), "  next %04X", block.next); os << line; }
+        os << "\n";
+    }
+}
+
+void
+Analyzer::exportListing(std::ostream &os, u16 from, u16 to) const
+{
+    auto &dasm = cpu.disassembler;
+
+    char data[16];
+    char instr[DASM_MAX_INSTR];
+    char line[96];
+
+    for (i32 addr = from; addr <= to; ) {
+
+        u8 bits = get(u16(addr));
+        isize numBytes = 1;
+
+        if (bits & ANALYSIS_OPCODE) {
+
+            if (bits & ANALYSIS_CALLED) {
+                snprintf(line, sizeof(line), "\nsub_%04X:\n", addr); os << line;
+            } else if (bits & ANALYSIS_LEADER) {
+                snprintf(line, sizeof(line), "L_%04X:\n", addr); os << line;
+            }
+
+            numBytes = dasm.disassemble(instr, u16(addr));
+
+        } else {
+
+            // Combine up to three consecutive data bytes
+            while (numBytes < 3 && addr + numBytes <= to &&
+                   !(get(u16(addr + numBytes)) & (ANALYSIS_OPCODE | ANALYSIS_LEADER))) {
+                numBytes++;
+            }
+
+            char *p = instr + snprintf(instr, sizeof(instr), ".BYTE ");
+            for (isize i = 0; i < numBytes; i++) {
+
+                if (i) *p++ = ',';
+                dasm.dumpByte(p, cpu.readDasm(u16(addr + i)));
+                p += strlen(p);
+            }
+        }
+
+        dasm.dumpBytes(data, u16(addr), numBytes);
+        snprintf(line, sizeof(line), "    %04X   %-9s   %s\n", addr, data, instr);
+        os << line;
+
+        addr += i32(numBytes);
+    }
+}
+
+}
@@ -0,0 +1,159 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <ostream>
+#include <vector>
+
+namespace peddle {
+
+// Classification bits
+static constexpr u8 ANALYSIS_OPCODE     = 0x01; // First byte of an instruction
+static constexpr u8 ANALYSIS_OPERAND    = 0x02; // Operand byte of an instruction
+static constexpr u8 ANALYSIS_LEADER     = 0x04; // Target of a control transfer
+static constexpr u8 ANALYSIS_CALLED     = 0x08; // Entry point or subroutine
+static constexpr u8 ANALYSIS_CONFLICT   = 0x10; // Overlaps another instruction
+static constexpr u8 ANALYSIS_INVALID    = 0x20; // Reached, but not decodable
+
+peddle_enum_long(BLOCK_EXIT)
+{
+    EXIT_FALLTHROUGH,   // The next instruction starts a new block
+    EXIT_BRANCH,        // Conditional branch
+    EXIT_JUMP,          // Absolute jump
+    EXIT_INDIRECT,      // Indirect jump (target unknown)
+    EXIT_CALL,          // Subroutine call
+    EXIT_RETURN,        // RTS or RTI
+    EXIT_INTERRUPT,     // BRK
+    EXIT_INVALID        // Control flows into data or an invalid opcode
+};
+typedef BLOCK_EXIT BlockExit;
+
+struct BasicBlock {
+
+    // Address of the first and the last instruction
+    u16 first;
+    u16 last;
+
+    // Number of instructions
+    isize count;
+
+    // The way the block is left
+    BlockExit exit;
+
+    // Branch, jump, or call target (-1 if none)
+    i32 target;
+
+    // Fall-through successor (-1 if none)
+    i32 next;
+};
+
+/* Static control-flow analyzer
+ *
+ * The analyzer separates code from data by recursively following the control
+ * flow, starting at the reset, IRQ, and NMI vectors and at user-supplied entry
+ * points. Memory is read once via readDasm(). Jumps, calls, and branches are
+ * followed. Subroutine calls are assumed to return. Indirect jumps, returns,
+ * and BRK end the flow. Illegal opcodes end the flow, too, unless they are
+ * explicitly permitted. JAM opcodes are never followed.
+ *
+ * The result is a classification map for the whole address space and a list
+ * of basic blocks sorted by address. Each block records how it is left and its
+ * successors. Unlike the coverage map, the result does not depend on what has
+ * been executed, and can thus be computed before the CPU runs.
+ */
+class Analyzer {
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Additional entry points
+    std::vector<u16> entries;
+
+    // Indicates whether illegal opcodes are treated as code
+    bool followIllegal = false;
+
+    // Classification map (allocated on first use)
+    u8 *map = nullptr;
+
+    // Basic blocks, sorted by address
+    std::vector<BasicBlock> blocks;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Analyzer(Peddle& ref) : cpu(ref) { }
+    ~Analyzer();
+
+
+    //
+    // Configuring
+    //
+
+public:
+
+    // Adds or removes user-supplied entry points
+    void addEntry(u16 addr) { entries.push_back(addr); }
+    void clearEntries() { entries.clear(); }
+
+    // Determines whether illegal opcodes are treated as code
+    void setFollowIllegal(bool value) { followIllegal = value; }
+
+
+    //
+    // Analyzing
+    //
+
+public:
+
+    // Analyzes the current memory contents
+    void analyze();
+
+    // Discards the analysis result
+    void clear();
+
+
+    //
+    // Querying results
+    //
+
+public:
+
+    // Returns the classification bits of an address
+    u8 get(u16 addr) const { return map ? map[addr] : 0; }
+    bool isCode(u16 addr) const { return get(addr) & (ANALYSIS_OPCODE | ANALYSIS_OPERAND); }
+
+    // Returns the number of addresses carrying any of the specified bits
+    isize count(u8 kinds) const;
+
+    // Returns all basic blocks
+    const std::vector<BasicBlock> &getBlocks() const { return blocks; }
+
+    // Returns the basic block containing an address (or nullptr)
+    const BasicBlock *blockAt(u16 addr) const;
+
+    // Prints all basic blocks
+    void dump(std::ostream &os) const;
+
+    // Prints a listing which disassembles code and dumps data
+    void exportListing(std::ostream &os, u16 from = 0, u16 to = 0xFFFF) const;
+
+private:
+
+    // Checks if an opcode may be decoded
+    bool isValid(u8 opcode) const;
+
+    // Splits the decoded instructions into basic blocks
+    void buildBlocks(const u8 *mem);
+};
+
+}
@@ -0,0 +1,240 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <bit>
+#include <cstring>
+
+namespace peddle {
+
+// Returns the highest set bit below nr, or -1
+static isize
+lastBefore(const u64 *bits, isize nr)
+{
+    if (nr <= 0) return -1;
+
+    isize i = (nr - 1) >> 6;
+    u64 word = bits[i] & (~u64(0) >> (63 - ((nr - 1) & 63)));
+
+    while (!word) {
+
+        if (--i < 0) return -1;
+        word = bits[i];
+    }
+    return i * 64 + 63 - std::countl_zero(word);
+}
+
+// Returns the lowest set bit above nr, or -1
+static isize
+firstAfter(const u64 *bits, isize words, isize nr)
+{
+    if (nr + 1 >= words * 64) return -1;
+
+    isize i = (nr + 1) >> 6;
+    u64 word = bits[i] & (~u64(0) << ((nr + 1) & 63));
+
+    while (!word) {
+
+        if (++i >= words) return -1;
+        word = bits[i];
+    }
+    return i * 64 + std::countr_zero(word);
+}
+
+BoundaryIndex::~BoundaryIndex()
+{
+    delete [] anchors;
+    delete [] starts;
+}
+
+void
+BoundaryIndex::reset()
+{
+    invalidateAll();
+    if (enabled) cpu.flags |= CPU_TRACK_BOUNDARIES;
+}
+
+void
+BoundaryIndex::alloc()
+{
+    if (anchors) return;
+
+    anchors = new u64[1024]();
+    starts = new u64[1024]();
+    for (isize i = 0; i < 256; i++) length[i] = u8(cpu.getLengthOfInstruction(u8(i)));
+}
+
+void
+BoundaryIndex::enable()
+{
+    alloc();
+    invalidateAll();
+
+    enabled = true;
+    cpu.flags |= CPU_TRACK_BOUNDARIES;
+}
+
+void
+BoundaryIndex::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_TRACK_BOUNDARIES;
+}
+
+void
+BoundaryIndex::clear()
+{
+    if (anchors) memset(anchors, 0, 1024 * sizeof(u64));
+    memset(anchorPages, 0, sizeof(anchorPages));
+    invalidateAll();
+}
+
+void
+BoundaryIndex::addAnchor(u16 addr)
+{
+    alloc();
+
+    if (test(anchors, addr)) return;
+
+    set(anchors, addr);
+    set(anchorPages, addr >> 8);
+    invalidateFrom(addr);
+}
+
+void
+BoundaryIndex::seed()
+{
+    alloc();
+
+    auto add = [&](u16 addr) {
+
+        set(anchors, addr);
+        set(anchorPages, addr >> 8);
+    };
+
+    // Executed instructions
+    auto &debugger = cpu.debugger;
+    for (isize i = 0; i < debugger.loggedInstructions(); i++) add(debugger.logEntryRel(i).pc);
+
+    for (isize i = 0; i < 65536; i++) {
+
+        if (cpu.coverage.get(u16(i)) & COVERAGE_OPCODE) add(u16(i));
+        if (cpu.analyzer.get(u16(i)) & ANALYSIS_OPCODE) add(u16(i));
+    }
+
+    invalidateAll();
+}
+
+void
+BoundaryIndex::invalidateAll()
+{
+    memset(validPages, 0, sizeof(validPages));
+}
+
+void
+BoundaryIndex::invalidateFrom(u16 addr)
+{
+    if (!anchors) return;
+
+    // The decoding is affected up to the next anchor
+    isize page = addr >> 8, last = 255;
+
+    if (auto next = firstAfter(anchors + page * 4, 4, addr & 0xFF); next >= 0) {
+        last = page;
+    } else if (next = firstAfter(anchorPages, 4, page); next >= 0) {
+        last = next;
+    }
+
+    for (isize i = page; i <= last; i++) unset(validPages, i);
+}
+
+void
+BoundaryIndex::prepare()
+{
+    alloc();
+    if (!enabled) invalidateAll();
+}
+
+void
+BoundaryIndex::decode(isize page)
+{
+    if (test(validPages, page)) return;
+
+    i64 first = page << 8;
+    i64 end = first + 256;
+
+    // Determine the starting point and the first page to be updated
+    i64 cursor = 0;
+    isize from = 0;
+
+    if (page > 0 && test(validPages, page - 1)) {
+
+        cursor = lastBefore(starts, first);
+        from = page;
+
+    } else if (auto anchorPage = lastBefore(anchorPages, page); anchorPage >= 0) {
+
+        cursor = lastBefore(anchors, (anchorPage + 1) << 8);
+        from = isize(cursor >> 8) + 1;
+    }
+
+    memset(starts + from * 4, 0, (page - from + 1) * 4 * sizeof(u64));
+
+    // Walk through memory
+    for (i64 addr = cursor; addr < end; ) {
+
+        if (addr >= from << 8) set(starts, addr);
+
+        i64 next = addr + length[cpu.readDasm(u16(addr))];
+
+        // Synchronize with anchors
+        for (i64 i = addr + 1; i < next && i < 65536; i++) {
+            if (test(anchors, i)) { next = i; break; }
+        }
+        addr = next;
+    }
+
+    for (isize i = from; i <= page; i++) set(validPages, i);
+}
+
+bool
+BoundaryIndex::isBoundary(u16 addr)
+{
+    prepare();
+    decode(addr >> 8);
+    return test(starts, addr);
+}
+
+u16
+BoundaryIndex::prev(u16 addr)
+{
+    return rewind(addr, 1);
+}
+
+u16
+BoundaryIndex::rewind(u16 addr, isize n, u16 *trail)
+{
+    prepare();
+
+    for (isize i = 0; i < n; i++) {
+
+        // One of the three preceding bytes is always an instruction start
+        isize j = 1;
+        for (; j < 3; j++) {
+
+            decode(u16(addr - j) >> 8);
+            if (test(starts, u16(addr - j))) break;
+        }
+        addr = u16(addr - j);
+        if (trail) trail[i] = addr;
+    }
+
+    return addr;
+}
+
+}
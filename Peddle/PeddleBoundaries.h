@@ -0,0 +1,144 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+
+namespace peddle {
+
+/* Instruction-boundary index
+ *
+ * Because instructions differ in length, the disassembler can only walk
+ * forward from a known instruction. This index answers where the instruction
+ * preceding an address starts, which allows walking backwards.
+ *
+ * All answers are derived from a single canonical decoding of the address
+ * space. The decoding starts at address 0 and proceeds instruction by
+ * instruction. It is synchronized at anchors, i.e., at addresses known to
+ * hold an opcode: If an instruction covers an anchor, the next instruction
+ * starts at the anchor. Since every anchor is visited, the decoding following
+ * an anchor does not depend on anything before it. Anchors are taken from
+ * the executed-PC history (the instruction log and the coverage map), from
+ * the control-flow analysis, or are added manually.
+ *
+ * The decoding is stored as a bitmap of instruction starts and computed
+ * lazily, page by page. A page is decoded starting at the last instruction
+ * of the previous page if that page is up to date, or at the last anchor
+ * in front of it otherwise. A write only invalidates the pages up to the
+ * next anchor, and only if it hits an opcode or a page that is not decoded.
+ *
+ * If write tracking is disabled, the index cannot detect modified memory.
+ * In this case, each query decodes the required pages from scratch. If the
+ * simple memory API is disabled, or if memory is modified without involving
+ * the CPU, the host is responsible for calling invalidate() itself.
+ */
+class BoundaryIndex {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Addresses known to hold an opcode (one bit per address)
+    u64 *anchors = nullptr;
+
+    // Instruction starts of the canonical decoding (one bit per address)
+    u64 *starts = nullptr;
+
+    // Pages with an anchor and pages with an up-to-date decoding
+    u64 anchorPages[4] = { };
+    u64 validPages[4] = { };
+
+    // Instruction lengths
+    u8 length[256];
+
+    // Indicates whether write tracking is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    BoundaryIndex(Peddle& ref) : cpu(ref) { }
+    ~BoundaryIndex();
+
+    void reset();
+
+private:
+
+    void alloc();
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns write tracking on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Removes all anchors and the decoding
+    void clear();
+
+    // Adds an anchor
+    void addAnchor(u16 addr);
+
+    // Adds anchors from the instruction log, coverage map, and analyzer
+    void seed();
+
+    // Informs the index about a modified memory location
+    void invalidate(u16 addr) {
+
+        if (!test(validPages, addr >> 8) || test(starts, addr)) invalidateFrom(addr);
+    }
+
+    // Discards the decoding of all pages
+    void invalidateAll();
+
+private:
+
+    // Discards the decoding of all pages that depend on an address
+    void invalidateFrom(u16 addr);
+
+    static bool test(const u64 *bits, isize nr) { return bits[nr >> 6] >> (nr & 63) & 1; }
+    static void set(u64 *bits, isize nr) { bits[nr >> 6] |= u64(1) << (nr & 63); }
+    static void unset(u64 *bits, isize nr) { bits[nr >> 6] &= ~(u64(1) << (nr & 63)); }
+
+
+    //
+    // Querying
+    //
+
+public:
+
+    // Checks whether an instruction starts at the given address
+    bool isBoundary(u16 addr);
+
+    // Returns the start of the instruction preceding the given address
+    u16 prev(u16 addr);
+
+    // Returns the start of the n-th instruction preceding the given address
+    // (if trail is provided, it receives all n starts, the nearest one first)
+    u16 rewind(u16 addr, isize n, u16 *trail = nullptr);
+
+private:
+
+    // Discards the decoding if memory changes cannot be tracked
+    void prepare();
+
+    // Makes sure that the decoding of a page is up to date
+    void decode(isize page);
+};
+
+}
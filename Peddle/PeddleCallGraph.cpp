@@ -0,0 +1,248 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace peddle {
+
+CallGraph::CallGraph(Peddle& ref) : cpu(ref)
+{
+    clear();
+}
+
+void
+CallGraph::reset()
+{
+    // The stack contents are lost, so are all open frames
+    stack.resize(1);
+    stack[0].entry = cpu.clock;
+    stack[0].childCycles = 0;
+
+    if (enabled) cpu.flags |= CPU_PROFILE_CALLS;
+}
+
+void
+CallGraph::enable()
+{
+    reset();
+    enabled = true;
+    cpu.flags |= CPU_PROFILE_CALLS;
+}
+
+void
+CallGraph::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_PROFILE_CALLS;
+}
+
+void
+CallGraph::clear()
+{
+    nodes.clear();
+    nodes.push_back(Node { -1, -1, -1, FRAME_ROOT, 0, { } });
+
+    stack.clear();
+    stack.push_back(Frame { 0, 0, cpu.clock, 0 });
+
+    for (auto &it : routines) {
+        it.second = CallStats { .budget = it.second.budget };
+    }
+    resyncs = 0;
+}
+
+void
+CallGraph::setBudget(FrameType type, u16 addr, u64 cycles)
+{
+    routines[u32(type) << 16 | addr].budget = cycles;
+}
+
+CallStats
+CallGraph::stats(FrameType type, u16 addr) const
+{
+    auto it = routines.find(u32(type) << 16 | addr);
+    return it == routines.end() ? CallStats { } : it->second;
+}
+
+void
+CallGraph::dump(std::ostream &os) const
+{
+    std::vector<std::pair<u32, CallStats>> sorted(routines.begin(), routines.end());
+    std::sort(sorted.begin(), sorted.end(), [](auto &a, auto &b) {
+        return a.second.inclusive > b.second.inclusive;
+    });
+
+    char line[128];
+
+    snprintf(line, sizeof(line), "%-10s %10s %14s %14s %10s %10s %8s\n",
+             "Routine", "Calls", "Inclusive", "Exclusive", "Average", "Maximum", "Overruns");
+    os << line;
+
+    for (auto &it : sorted) {
+
+        auto &s = it.second;
+        if (!s.calls) continue;
+
+        snprintf(line, sizeof(line), "%-10s %10llu %14llu %14llu %10llu %10llu %8llu\n",
+                 name(FrameType(it.first >> 16), u16(it.first)).c_str(),
+                 (unsigned long long)s.calls,
+                 (unsigned long long)s.inclusive,
+                 (unsigned long long)s.exclusive,
+                 (unsigned long long)(s.inclusive / s.calls),
+                 (unsigned long long)s.maxInclusive,
+                 (unsigned long long)s.overruns);
+        os << line;
+    }
+}
+
+void
+CallGraph::exportFolded(std::ostream &os) const
+{
+    auto tree = snapshot();
+
+    for (isize i = 0; i < isize(tree.size()); i++) {
+
+        if (!tree[i].stats.exclusive) continue;
+
+        std::string path = name(tree[i].type, tree[i].addr);
+        for (isize p = tree[i].parent; p >= 0; p = tree[p].parent) {
+            path = name(tree[p].type, tree[p].addr) + ";" + path;
+        }
+        os << path << " " << tree[i].stats.exclusive << "\n";
+    }
+}
+
+std::string
+CallGraph::name(FrameType type, u16 addr)
+{
+    char str[16];
+
+    switch (type) {
+
+        case FRAME_SUBROUTINE:  snprintf(str, sizeof(str), "sub_%04X", addr); break;
+        case FRAME_IRQ:         snprintf(str, sizeof(str), "irq_%04X", addr); break;
+        case FRAME_NMI:         snprintf(str, sizeof(str), "nmi_%04X", addr); break;
+        case FRAME_BRK:         snprintf(str, sizeof(str), "brk_%04X", addr); break;
+
+        default:
+            return "main";
+    }
+    return str;
+}
+
+std::vector<CallGraph::Node>
+CallGraph::snapshot() const
+{
+    auto result = nodes;
+
+    // Account for the cycles of all frames that are still open
+    u64 above = 0;
+    for (isize i = isize(stack.size()) - 1; i >= 0; i--) {
+
+        auto &frame = stack[i];
+        u64 inclusive = u64(cpu.clock - frame.entry);
+
+        result[frame.node].stats.inclusive += inclusive;
+        result[frame.node].stats.exclusive += inclusive - frame.childCycles - above;
+        above = inclusive;
+    }
+
+    return result;
+}
+
+void
+CallGraph::recordInstruction(MicroInstruction last)
+{
+    switch (last) {
+
+        case JSR_5:         push(FRAME_SUBROUTINE, cpu.reg.pc, cpu.reg.sp); break;
+        case BRK_6:         push(FRAME_BRK, cpu.reg.pc, cpu.reg.sp); break;
+        case BRK_nmi_6:     push(FRAME_NMI, cpu.reg.pc, cpu.reg.sp); break;
+        case irq_7:         push(FRAME_IRQ, cpu.reg.pc, cpu.reg.sp); break;
+        case nmi_7:         push(FRAME_NMI, cpu.reg.pc, cpu.reg.sp); break;
+        case RTS_5:         pop(cpu.reg.sp, 2); break;
+        case RTI_5:         pop(cpu.reg.sp, 3); break;
+
+        default:
+            break;
+    }
+}
+
+void
+CallGraph::push(FrameType type, u16 addr, u8 sp)
+{
+    // Close all frames that have been abandoned by resetting the stack
+    if (stack.size() > 1 && i8(sp - stack.back().sp) >= 0) {
+
+        while (stack.size() > 1 && i8(sp - stack.back().sp) >= 0) close();
+        resyncs++;
+    }
+
+    // Find or create the node of the calling context tree
+    isize parent = stack.back().node;
+    isize node = nodes[parent].child;
+
+    while (node >= 0 && (nodes[node].type != type || nodes[node].addr != addr)) {
+        node = nodes[node].sibling;
+    }
+    if (node < 0) {
+
+        node = isize(nodes.size());
+        nodes.push_back(Node { parent, -1, nodes[parent].child, type, addr, { } });
+        nodes[parent].child = node;
+    }
+
+    stack.push_back(Frame { node, sp, cpu.clock, 0 });
+}
+
+void
+CallGraph::pop(u8 sp, isize expected)
+{
+    isize closed = 0;
+    u8 top = stack.back().sp;
+
+    while (stack.size() > 1 && i8(sp - stack.back().sp) > 0) { close(); closed++; }
+
+    // Check whether a single frame has been closed in the regular way
+    if (closed != 1 || sp != u8(top + expected)) resyncs++;
+}
+
+void
+CallGraph::close()
+{
+    auto frame = stack.back();
+    stack.pop_back();
+
+    auto &node = nodes[frame.node];
+    auto &routine = routines[u32(node.type) << 16 | node.addr];
+
+    u64 inclusive = u64(cpu.clock - frame.entry);
+    u64 exclusive = inclusive - std::min(inclusive, frame.childCycles);
+
+    stack.back().childCycles += inclusive;
+
+    // Check whether this is a recursive invocation
+    bool recursive = false;
+    for (auto &f : stack) {
+        if (nodes[f.node].type == node.type && nodes[f.node].addr == node.addr) recursive = true;
+    }
+
+    for (CallStats *s : { &node.stats, &routine }) {
+
+        s->calls++;
+        s->exclusive += exclusive;
+        s->maxInclusive = std::max(s->maxInclusive, inclusive);
+        if (s->budget && inclusive > s->budget) s->overruns++;
+    }
+    node.stats.inclusive += inclusive;
+    if (!recursive) routine.inclusive += inclusive;
+}
+
+}
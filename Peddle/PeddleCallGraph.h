@@ -0,0 +1,203 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace peddle {
+
+peddle_enum_long(FRAME_TYPE)
+{
+    FRAME_ROOT,         // Code running outside of any known routine
+    FRAME_SUBROUTINE,   // Entered via JSR
+    FRAME_IRQ,          // Entered via an IRQ
+    FRAME_NMI,          // Entered via an NMI
+    FRAME_BRK           // Entered via a BRK instruction
+};
+typedef FRAME_TYPE FrameType;
+
+// Execution statistics of a routine or a calling context
+struct CallStats {
+
+    // Number of completed invocations
+    u64 calls;
+
+    // Number of cycles spent in the routine, including all callees
+    u64 inclusive;
+
+    // Number of cycles spent in the routine itself
+    u64 exclusive;
+
+    // Maximum number of inclusive cycles of a single invocation
+    u64 maxInclusive;
+
+    // Cycle budget of a single invocation (0 = unlimited)
+    u64 budget;
+
+    // Number of invocations that exceeded the budget
+    u64 overruns;
+};
+
+/* Call graph profiler
+ *
+ * The profiler maintains a shadow call stack that mirrors the subroutine and
+ * interrupt frames on the 6502 stack. A frame is pushed when a JSR, BRK, IRQ,
+ * or NMI sequence completes and popped when the matching RTS or RTI returns.
+ * Inclusive and exclusive cycles are accumulated per routine and per calling
+ * context, i.e., per path from the root to the routine.
+ *
+ * Frames are matched by the stack pointer, not by counting. Each frame
+ * remembers the stack pointer right after the return address was pushed.
+ * After an RTS or RTI, all frames whose return address has been pulled off
+ * the stack are closed. Hence, an RTS that merely jumps to an address pushed
+ * by the program (RTS trick) closes no frame, and code that drops its own
+ * return address and returns to its caller's caller closes two. A new frame
+ * that is pushed above the current top frame indicates that the stack has
+ * been reset and closes the abandoned frames. Such mismatches are counted as
+ * resynchronizations. Because the stack wraps around, stack pointers are
+ * compared modulo 256.
+ */
+class CallGraph {
+
+    friend class Peddle;
+
+    // Node of the calling context tree
+    struct Node {
+
+        // Parent node (-1 for the root)
+        isize parent;
+
+        // First child and next sibling (-1 if none)
+        isize child;
+        isize sibling;
+
+        // Frame type and entry address
+        FrameType type;
+        u16 addr;
+
+        // Accumulated statistics
+        CallStats stats;
+    };
+
+    // Entry of the shadow stack
+    struct Frame {
+
+        // Node of the calling context tree
+        isize node;
+
+        // Stack pointer after the return address has been pushed
+        u8 sp;
+
+        // Clock value at frame entry
+        i64 entry;
+
+        // Inclusive cycles of all completed callees
+        u64 childCycles;
+    };
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Calling context tree (node 0 is the root)
+    std::vector<Node> nodes;
+
+    // Shadow call stack (frame 0 is the root)
+    std::vector<Frame> stack;
+
+    // Statistics per routine (key = type << 16 | entry address)
+    std::unordered_map<u32, CallStats> routines;
+
+    // Number of stack resynchronizations
+    u64 resyncs = 0;
+
+    // Indicates whether profiling is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    CallGraph(Peddle& ref);
+
+    void reset();
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns profiling on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Discards all recorded data
+    void clear();
+
+    // Assigns a cycle budget to a routine
+    void setBudget(FrameType type, u16 addr, u64 cycles);
+
+
+    //
+    // Analyzing
+    //
+
+public:
+
+    // Returns the statistics of a routine
+    CallStats stats(FrameType type, u16 addr) const;
+
+    // Returns the current nesting depth
+    isize depth() const { return isize(stack.size()) - 1; }
+
+    // Returns the number of stack resynchronizations
+    u64 getResyncs() const { return resyncs; }
+
+    // Prints a per-routine report, sorted by inclusive cycles
+    void dump(std::ostream &os) const;
+
+    // Exports the profile in folded stack format (flamegraph.pl, speedscope)
+    void exportFolded(std::ostream &os) const;
+
+private:
+
+    // Returns a textual representation of a frame
+    static std::string name(FrameType type, u16 addr);
+
+    // Returns the nodes with the cycles of all open frames added
+    std::vector<Node> snapshot() const;
+
+
+    //
+    // Recording
+    //
+
+private:
+
+    // Called at the end of each instruction or interrupt sequence
+    void recordInstruction(MicroInstruction last);
+
+    // Opens a new frame
+    void push(FrameType type, u16 addr, u8 sp);
+
+    // Closes all frames whose return address has been pulled
+    void pop(u8 sp, isize expected);
+
+    // Closes the top-most frame
+    void close();
+};
+
+}
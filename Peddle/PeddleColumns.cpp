@@ -0,0 +1,347 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleColumns.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace peddle {
+
+static_assert(std::endian::native == std::endian::little, "columnar traces require a little-endian host");
+
+// Alignment of all columns
+static constexpr u64 COLUMN_ALIGNMENT = 64;
+
+// Size of the file header and the trailer
+static constexpr u64 COLUMN_HEADER_SIZE = 16;
+static constexpr u64 COLUMN_TRAILER_SIZE = 32;
+
+static inline u64
+align(u64 offset)
+{
+    return (offset + COLUMN_ALIGNMENT - 1) & ~(COLUMN_ALIGNMENT - 1);
+}
+
+
+//
+// ColumnWriter
+//
+
+ColumnWriter::ColumnWriter(std::ostream &os, isize chunkSize) : os(os), chunkSize(chunkSize)
+{
+    if (chunkSize < 1 || chunkSize > UINT32_MAX) throw std::runtime_error("invalid chunk size");
+
+    u32 header[4] = { COLUMN_MAGIC, COLUMN_VERSION, u32(chunkSize), 0 };
+    put(header, sizeof(header), true);
+
+    cycles.reserve(chunkSize);
+    pcs.reserve(chunkSize);
+    for (auto &column : columns) column.reserve(chunkSize);
+}
+
+ColumnWriter::~ColumnWriter()
+{
+    try { finish(); } catch (...) { }
+}
+
+void
+ColumnWriter::write(const RecordedInstruction &instr)
+{
+    if (finished) throw std::runtime_error("trace has been finished");
+
+    // Close the chunk if the cycle can't be stored relative to the first one
+    if (!cycles.empty() && (instr.cycle < base || instr.cycle - base > UINT32_MAX)) flush();
+    if (cycles.empty()) base = instr.cycle;
+
+    cycles.push_back(u32(instr.cycle - base));
+    pcs.push_back(instr.pc);
+    columns[COLUMN_A].push_back(instr.a);
+    columns[COLUMN_X].push_back(instr.x);
+    columns[COLUMN_Y].push_back(instr.y);
+    columns[COLUMN_SP].push_back(instr.sp);
+    columns[COLUMN_FLAGS].push_back(instr.flags);
+    columns[COLUMN_BYTE1].push_back(instr.byte1);
+    columns[COLUMN_BYTE2].push_back(instr.byte2);
+    columns[COLUMN_BYTE3].push_back(instr.byte3);
+    records++;
+
+    if (isize(cycles.size()) == chunkSize) flush();
+}
+
+void
+ColumnWriter::finish()
+{
+    if (finished) return;
+
+    flush();
+
+    u64 offset = written;
+    put(directory.data(), directory.size() * sizeof(u64));
+
+    u64 trailer[4] = { directory.size(), offset, records, COLUMN_INDEX_MAGIC };
+    put(trailer, sizeof(trailer));
+
+    os.flush();
+    finished = true;
+}
+
+void
+ColumnWriter::flush()
+{
+    if (cycles.empty()) return;
+
+    auto count = cycles.size();
+
+    ColumnChunk header = { };
+    header.firstRecord = records - count;
+    header.firstCycle = base;
+    header.lastCycle = base + cycles.back();
+    header.count = u32(count);
+
+    auto pcRange = std::minmax_element(pcs.begin(), pcs.end());
+    header.pcMin = *pcRange.first;
+    header.pcMax = *pcRange.second;
+
+    for (isize i = 0; i < COLUMN_COUNT; i++) {
+
+        auto range = std::minmax_element(columns[i].begin(), columns[i].end());
+        header.min[i] = *range.first;
+        header.max[i] = *range.second;
+        if (header.min[i] == header.max[i]) header.constant |= u16(1 << i);
+    }
+
+    directory.push_back(written);
+    put(&header, sizeof(header));
+    put(cycles.data(), count * sizeof(u32), true);
+    put(pcs.data(), count * sizeof(u16), true);
+
+    for (isize i = 0; i < COLUMN_COUNT; i++) {
+        if (!(header.constant & (1 << i))) put(columns[i].data(), count, true);
+    }
+
+    cycles.clear();
+    pcs.clear();
+    for (auto &column : columns) column.clear();
+}
+
+void
+ColumnWriter::put(const void *data, usize size, bool pad)
+{
+    static const char zeros[COLUMN_ALIGNMENT] = { };
+
+    os.write((const char *)data, std::streamsize(size));
+    written += size;
+
+    if (pad) {
+
+        auto padding = align(written) - written;
+        os.write(zeros, std::streamsize(padding));
+        written += padding;
+    }
+}
+
+
+//
+// ColumnReader
+//
+
+ColumnReader::ColumnReader(const std::string &path)
+{
+#ifndef _WIN32
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+
+        size = u64(st.st_size);
+        mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) mapping = nullptr;
+    }
+    close(fd);
+
+    if (mapping) {
+
+        data = (const u8 *)mapping;
+        init();
+        return;
+    }
+
+#endif
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) throw std::runtime_error("cannot open " + path);
+
+    storage.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    data = storage.data();
+    size = storage.size();
+    init();
+}
+
+ColumnReader::ColumnReader(const u8 *data, u64 size) : data(data), size(size)
+{
+    init();
+}
+
+ColumnReader::~ColumnReader()
+{
+#ifndef _WIN32
+    if (mapping) munmap(mapping, size);
+#endif
+}
+
+void
+ColumnReader::init()
+{
+    auto fail = [&](const char *msg) {
+
+#ifndef _WIN32
+        if (mapping) { munmap(mapping, size); mapping = nullptr; }
+#endif
+        throw std::runtime_error(msg);
+    };
+
+    u32 header[4];
+    u64 trailer[4];
+
+    if (size < align(COLUMN_HEADER_SIZE) + COLUMN_TRAILER_SIZE) fail("not a columnar Peddle trace");
+
+    memcpy(header, data, sizeof(header));
+    if (header[0] != COLUMN_MAGIC) fail("not a columnar Peddle trace");
+    if (header[1] != COLUMN_VERSION) fail("unsupported trace version");
+
+    memcpy(trailer, data + size - COLUMN_TRAILER_SIZE, sizeof(trailer));
+    u64 count = trailer[0], offset = trailer[1];
+    records = trailer[2];
+
+    if (trailer[3] != COLUMN_INDEX_MAGIC) fail("trace is truncated");
+    if (offset > size - COLUMN_TRAILER_SIZE || count > (size - COLUMN_TRAILER_SIZE - offset) / 8) {
+        fail("trace directory is corrupted");
+    }
+
+    // Locate all columns
+    u64 total = 0;
+    chunks.resize(count);
+
+    for (u64 i = 0; i < count; i++) {
+
+        u64 pos;
+        memcpy(&pos, data + offset + 8 * i, sizeof(pos));
+
+        // Compare against the remaining space to rule out wrap-arounds
+        if (pos % COLUMN_ALIGNMENT || offset < sizeof(ColumnChunk) || pos > offset - sizeof(ColumnChunk)) {
+            fail("trace is corrupted");
+        }
+
+        auto &chunk = chunks[i];
+        chunk.header = (const ColumnChunk *)(data + pos);
+
+        u64 n = chunk.header->count;
+        if (chunk.header->firstRecord != total) fail("trace is corrupted");
+        total += n;
+
+        pos += sizeof(ColumnChunk);
+        if (n > (offset - pos) / 4) fail("trace is corrupted");
+        chunk.cycles = (const u32 *)(data + pos);
+        pos = align(pos + 4 * n);
+        chunk.pcs = (const u16 *)(data + pos);
+        pos = align(pos + 2 * n);
+
+        for (isize j = 0; j < COLUMN_COUNT; j++) {
+
+            if (chunk.header->constant & (1 << j)) {
+
+                chunk.columns[j] = nullptr;
+
+            } else {
+
+                chunk.columns[j] = data + pos;
+                pos = align(pos + n);
+            }
+        }
+
+        if (pos > offset) fail("trace is corrupted");
+    }
+
+    if (total != records) fail("trace is corrupted");
+}
+
+CycleView
+ColumnReader::cycles(isize nr) const
+{
+    auto &chunk = chunks[nr];
+    return CycleView { chunk.header->firstCycle, chunk.cycles, chunk.header->count };
+}
+
+ColumnView<u16>
+ColumnReader::pcs(isize nr) const
+{
+    auto &chunk = chunks[nr];
+    return ColumnView<u16> { chunk.pcs, 0, chunk.header->count };
+}
+
+ColumnView<u8>
+ColumnReader::column(isize nr, TraceColumn col) const
+{
+    auto &chunk = chunks[nr];
+    return ColumnView<u8> { chunk.columns[col], chunk.header->min[col], chunk.header->count };
+}
+
+isize
+ColumnReader::findRecord(u64 nr) const
+{
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), nr, [](u64 nr, const Chunk &c) {
+        return nr < c.header->firstRecord;
+    });
+    return isize(it - chunks.begin()) - 1;
+}
+
+isize
+ColumnReader::findCycle(u64 cycle) const
+{
+    auto it = std::lower_bound(chunks.begin(), chunks.end(), cycle, [](const Chunk &c, u64 cycle) {
+        return c.header->lastCycle < cycle;
+    });
+    return isize(it - chunks.begin());
+}
+
+RecordedInstruction
+ColumnReader::record(u64 nr) const
+{
+    if (nr >= records) throw std::runtime_error("record number out of range");
+
+    auto c = findRecord(nr);
+    auto i = isize(nr - chunks[c].header->firstRecord);
+
+    return RecordedInstruction {
+
+        .cycle = cycles(c)[i],
+        .byte1 = column(c, COLUMN_BYTE1)[i],
+        .byte2 = column(c, COLUMN_BYTE2)[i],
+        .byte3 = column(c, COLUMN_BYTE3)[i],
+        .pc = pcs(c)[i],
+        .sp = column(c, COLUMN_SP)[i],
+        .a = column(c, COLUMN_A)[i],
+        .x = column(c, COLUMN_X)[i],
+        .y = column(c, COLUMN_Y)[i],
+        .flags = column(c, COLUMN_FLAGS)[i]
+    };
+}
+
+}
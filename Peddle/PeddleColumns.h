@@ -0,0 +1,262 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace peddle {
+
+/* Columnar trace format
+ *
+ * The columnar format stores a trace as a structure of arrays, which allows
+ * aggregate queries to scan a single field without decoding whole records.
+ * Records are grouped into chunks. Each chunk starts with a header and holds
+ * one array per field. All arrays start at a 64-byte boundary and can be
+ * processed in place, e.g., with SIMD instructions, after the file has been
+ * mapped into memory.
+ *
+ *     File layout: Header Chunk Chunk ... Chunk Directory Trailer
+ *
+ *          Header: "PCOL" (4 bytes), version (u16), reserved (u16),
+ *                  chunk size (u32), reserved (u32)
+ *           Chunk: Chunk header (64 bytes), cycle offsets (u32[]), pc (u16[]),
+ *                  a, x, y, sp, flags, byte1, byte2, byte3 (u8[] each)
+ *       Directory: One file offset per chunk (u64)
+ *         Trailer: chunk count (u64), directory offset (u64), record count
+ *                  (u64), "PCLX" (4 bytes), reserved (u32)
+ *
+ * The header, the chunk headers, and all columns are padded to a multiple of
+ * 64 bytes.
+ *
+ * The columns are compressed lightly to keep them directly accessible. Cycles
+ * are stored relative to the first cycle of the chunk (frame of reference).
+ * A chunk is closed early if an offset would not fit into 32 bits. Byte
+ * columns holding the same value for all records of a chunk are omitted. The
+ * value is stored in the chunk header instead, which also records the minimum
+ * and maximum value of each column for skipping chunks in range queries.
+ *
+ * All multi-byte values are stored in little-endian byte order. Big-endian
+ * hosts are not supported.
+ */
+
+static constexpr u32 COLUMN_MAGIC = 0x4C4F4350;       // "PCOL"
+static constexpr u32 COLUMN_INDEX_MAGIC = 0x584C4350; // "PCLX"
+static constexpr u16 COLUMN_VERSION = 1;
+
+// Byte columns
+peddle_enum_long(TRACE_COLUMN)
+{
+    COLUMN_A,
+    COLUMN_X,
+    COLUMN_Y,
+    COLUMN_SP,
+    COLUMN_FLAGS,
+    COLUMN_BYTE1,
+    COLUMN_BYTE2,
+    COLUMN_BYTE3
+};
+typedef TRACE_COLUMN TraceColumn;
+
+static constexpr isize COLUMN_COUNT = 8;
+
+// Chunk header as stored in the file
+struct ColumnChunk {
+
+    // Number of the first record
+    u64 firstRecord;
+
+    // Cycle of the first and the last record
+    u64 firstCycle;
+    u64 lastCycle;
+
+    // Number of records
+    u32 count;
+
+    // Byte columns omitted from the chunk (bit n refers to TraceColumn n)
+    u16 constant;
+
+    // Value range of the program counter
+    u16 pcMin;
+    u16 pcMax;
+
+    // Value range of each byte column
+    u8 min[COLUMN_COUNT];
+    u8 max[COLUMN_COUNT];
+
+    u8 reserved[14];
+};
+
+static_assert(sizeof(ColumnChunk) == 64);
+
+// Read-only view of a single column of a chunk
+template <class T> struct ColumnView {
+
+    // Column data (nullptr if the column holds a single value)
+    const T *data;
+
+    // Value of all records (if data is nullptr)
+    T value;
+
+    // Number of records
+    isize count;
+
+    T operator[](isize i) const { return data ? data[i] : value; }
+};
+
+// Read-only view of the cycle column of a chunk
+struct CycleView {
+
+    u64 base;
+    const u32 *offsets;
+    isize count;
+
+    u64 operator[](isize i) const { return base + offsets[i]; }
+};
+
+class ColumnWriter {
+
+    // Output stream
+    std::ostream &os;
+
+    // Maximum number of records per chunk
+    isize chunkSize;
+
+    // Columns of the current chunk
+    std::vector<u32> cycles;
+    std::vector<u16> pcs;
+    std::vector<u8> columns[COLUMN_COUNT];
+
+    // Cycle of the first record in the current chunk
+    u64 base = 0;
+
+    // Number of written bytes
+    u64 written = 0;
+
+    // Number of written records
+    u64 records = 0;
+
+    // File offsets of all chunks
+    std::vector<u64> directory;
+
+    // Indicates whether the directory and the trailer have been written
+    bool finished = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    ColumnWriter(std::ostream &os, isize chunkSize = 65536);
+    ~ColumnWriter();
+
+
+    //
+    // Writing
+    //
+
+public:
+
+    // Appends a record to the trace
+    void write(const RecordedInstruction &instr);
+    ColumnWriter& operator<<(const RecordedInstruction &instr) { write(instr); return *this; }
+
+    // Writes the directory and flushes all buffered data
+    void finish();
+
+    // Returns the number of written records
+    u64 count() const { return records; }
+
+private:
+
+    // Writes the current chunk
+    void flush();
+
+    // Writes raw data, optionally followed by padding up to the next 64-byte boundary
+    void put(const void *data, usize size, bool align = false);
+};
+
+class ColumnReader {
+
+    // Pointers into the trace data
+    struct Chunk {
+
+        const ColumnChunk *header;
+        const u32 *cycles;
+        const u16 *pcs;
+        const u8 *columns[COLUMN_COUNT];
+    };
+
+    // Trace data (mapped, owned, or provided by the caller)
+    const u8 *data = nullptr;
+    u64 size = 0;
+    std::vector<u8> storage;
+    void *mapping = nullptr;
+
+    // All chunks
+    std::vector<Chunk> chunks;
+
+    // Total number of records
+    u64 records = 0;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    // Maps a trace file into memory (or reads it if mapping is unavailable)
+    ColumnReader(const std::string &path);
+
+    // Reads a trace stored in memory (the data is not copied)
+    ColumnReader(const u8 *data, u64 size);
+
+    ~ColumnReader();
+
+    ColumnReader(const ColumnReader &) = delete;
+    ColumnReader& operator=(const ColumnReader &) = delete;
+
+private:
+
+    void init();
+
+
+    //
+    // Accessing
+    //
+
+public:
+
+    // Returns the number of records or chunks
+    u64 count() const { return records; }
+    isize chunkCount() const { return isize(chunks.size()); }
+
+    // Returns the header of a chunk
+    const ColumnChunk &chunk(isize nr) const { return *chunks[nr].header; }
+
+    // Returns a column of a chunk
+    CycleView cycles(isize nr) const;
+    ColumnView<u16> pcs(isize nr) const;
+    ColumnView<u8> column(isize nr, TraceColumn col) const;
+
+    // Returns the chunk containing a record
+    isize findRecord(u64 nr) const;
+
+    // Returns the first chunk with a last cycle >= the given one
+    isize findCycle(u64 cycle) const;
+
+    // Reassembles a single record
+    RecordedInstruction record(u64 nr) const;
+};
+
+}
@@ -0,0 +1,94 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+
+namespace peddle {
+
+void
+CommandQueue::reset()
+{
+    if (enabled) cpu.flags |= CPU_PROCESS_COMMANDS;
+}
+
+void
+CommandQueue::enable()
+{
+    enabled = true;
+    cpu.flags |= CPU_PROCESS_COMMANDS;
+}
+
+void
+CommandQueue::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_PROCESS_COMMANDS;
+}
+
+bool
+CommandQueue::put(CPUCommand type, i64 value, i64 value2)
+{
+    return queue.push(Command { type, value, value2 });
+}
+
+void
+CommandQueue::process()
+{
+    Command cmd;
+    while (queue.pop(cmd)) execute(cmd);
+}
+
+void
+CommandQueue::execute(const Command &cmd)
+{
+    auto &debugger = cpu.debugger;
+    auto addr = u32(cmd.value);
+    auto mask = u8(cmd.value);
+
+    switch (cmd.type) {
+
+        case CMD_SET_BREAKPOINT:         debugger.breakpoints.setAt(addr, long(cmd.value2)); break;
+        case CMD_REMOVE_BREAKPOINT:      debugger.breakpoints.removeAt(addr); break;
+        case CMD_ENABLE_BREAKPOINT:      debugger.breakpoints.enableAt(addr); break;
+        case CMD_DISABLE_BREAKPOINT:     debugger.breakpoints.disableAt(addr); break;
+        case CMD_REMOVE_ALL_BREAKPOINTS: debugger.breakpoints.removeAll(); break;
+
+        case CMD_SET_WATCHPOINT:         debugger.watchpoints.setAt(addr, long(cmd.value2)); break;
+        case CMD_REMOVE_WATCHPOINT:      debugger.watchpoints.removeAt(addr); break;
+        case CMD_ENABLE_WATCHPOINT:      debugger.watchpoints.enableAt(addr); break;
+        case CMD_DISABLE_WATCHPOINT:     debugger.watchpoints.disableAt(addr); break;
+        case CMD_REMOVE_ALL_WATCHPOINTS: debugger.watchpoints.removeAll(); break;
+
+        case CMD_ENABLE_LOGGING:         debugger.enableLogging(); break;
+        case CMD_DISABLE_LOGGING:        debugger.disableLogging(); break;
+
+        case CMD_PULL_DOWN_NMI:          cpu.pullDownNmiLine(mask); break;
+        case CMD_RELEASE_NMI:            cpu.releaseNmiLine(mask); break;
+        case CMD_PULL_DOWN_IRQ:          cpu.pullDownIrqLine(mask); break;
+        case CMD_RELEASE_IRQ:            cpu.releaseIrqLine(mask); break;
+        case CMD_PULL_DOWN_RDY:          cpu.pullDownRdyLine(mask); break;
+        case CMD_RELEASE_RDY:            cpu.releaseRdyLine(mask); break;
+
+        case CMD_JUMP:                   debugger.jump(u16(cmd.value)); break;
+
+        case CMD_SUSPEND:
+
+            if (!suspended) { suspended = true; cpu.cpuDidSuspend(); }
+            break;
+
+        case CMD_RESUME:
+
+            if (suspended) { suspended = false; cpu.cpuDidResume(); }
+            break;
+
+        default:
+            break;
+    }
+}
+
+}
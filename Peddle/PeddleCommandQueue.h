@@ -0,0 +1,136 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include "PeddleUtils.h"
+
+namespace peddle {
+
+peddle_enum_long(CPU_COMMAND)
+{
+    CMD_SET_BREAKPOINT,         // value: address, value2: ignore count
+    CMD_REMOVE_BREAKPOINT,      // value: address
+    CMD_ENABLE_BREAKPOINT,      // value: address
+    CMD_DISABLE_BREAKPOINT,     // value: address
+    CMD_REMOVE_ALL_BREAKPOINTS,
+
+    CMD_SET_WATCHPOINT,         // value: address, value2: ignore count
+    CMD_REMOVE_WATCHPOINT,      // value: address
+    CMD_ENABLE_WATCHPOINT,      // value: address
+    CMD_DISABLE_WATCHPOINT,     // value: address
+    CMD_REMOVE_ALL_WATCHPOINTS,
+
+    CMD_ENABLE_LOGGING,
+    CMD_DISABLE_LOGGING,
+
+    CMD_PULL_DOWN_NMI,          // value: interrupt source
+    CMD_RELEASE_NMI,            // value: interrupt source
+    CMD_PULL_DOWN_IRQ,          // value: interrupt source
+    CMD_RELEASE_IRQ,            // value: interrupt source
+    CMD_PULL_DOWN_RDY,          // value: source
+    CMD_RELEASE_RDY,            // value: source
+
+    CMD_JUMP,                   // value: address
+    CMD_SUSPEND,
+    CMD_RESUME
+};
+typedef CPU_COMMAND CPUCommand;
+
+struct Command {
+
+    CPUCommand type;
+    i64 value;
+    i64 value2;
+};
+
+/* Command queue
+ *
+ * The command queue allows other threads to control a running CPU. Most parts
+ * of the CPU and the debugger must not be modified while the emulation thread
+ * is running, e.g., setting a breakpoint may reallocate the breakpoint storage.
+ * Instead of calling these functions directly, other threads put a command
+ * into the queue, which is drained by the CPU at the next instruction
+ * boundary. put() is lock-free and may be called by any number of threads.
+ *
+ * While the queue is empty, the CPU pays a single atomic load per instruction.
+ * Commands are only processed at the end of an instruction. If the CPU does
+ * not reach an instruction boundary, e.g., because it is jammed, the host can
+ * drain the queue by calling process() on the emulation thread.
+ *
+ * The CPU does not own the run loop. Hence, CMD_SUSPEND and CMD_RESUME only
+ * change the state reported by isSuspended() and inform the host via the
+ * cpuDidSuspend() and cpuDidResume() delegates. The host must not execute any
+ * instructions while the CPU is suspended, and it has to call process()
+ * regularly to receive the resume command.
+ */
+class CommandQueue {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Pending commands
+    MPSCQueue <Command, 256> queue;
+
+    // Indicates whether the host has been asked to suspend the CPU
+    std::atomic<bool> suspended = false;
+
+    // Indicates whether command processing is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    CommandQueue(Peddle& ref) : cpu(ref) { }
+
+    void reset();
+
+
+    //
+    // Controlling (emulation thread)
+    //
+
+public:
+
+    // Turns command processing at instruction boundaries on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Executes all pending commands
+    void process();
+
+private:
+
+    // Called at the end of each instruction or interrupt sequence
+    void recordInstruction() { if (!queue.isEmpty()) process(); }
+
+    // Executes a single command
+    void execute(const Command &cmd);
+
+
+    //
+    // Issuing commands (any thread)
+    //
+
+public:
+
+    // Appends a command (returns false if the queue is full)
+    bool put(CPUCommand type, i64 value = 0, i64 value2 = 0);
+
+    // Returns true if the host must not run the CPU
+    bool isSuspended() const { return suspended; }
+};
+
+}
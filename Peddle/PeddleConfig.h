@@ -33,6 +33,20 @@
  */
 #define PEDDLE_ENABLE_WATCHPOINTS true
 
+/* Memory hooks
+ *
+ * Several analysis features observe the memory accesses of the CPU, namely
+ * coverage tracking, the undo journal, the cross-reference index, the
+ * instruction-boundary index, and the disassembly cache. Together with the
+ * watchpoint check, these hooks are placed inside a single branch per memory
+ * access, which is only taken if one of the features is active. If none of
+ * them is needed, the hooks can be omitted by setting this option to false.
+ * The features then no longer see any memory accesses.
+ *
+ * Enable to support memory-observing features, disable to gain speed.
+ */
+#define PEDDLE_ENABLE_MEMORY_HOOKS true
+
 /* Memory API
  *
  * Peddle offers two interfaces to interact with the connected memory. The
@@ -0,0 +1,173 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <cstdio>
+#include <stdexcept>
+
+namespace peddle {
+
+// Magic number of the binary bitmap format ("PCOV")
+static constexpr u32 COVERAGE_MAGIC = 0x564F4350;
+
+// Size of a single bit plane
+static constexpr isize COVERAGE_PLANE_SIZE = 65536 / 8;
+
+Coverage::~Coverage()
+{
+    delete [] map;
+}
+
+void
+Coverage::reset()
+{
+    if (enabled) cpu.flags |= CPU_TRACK_COVERAGE;
+}
+
+void
+Coverage::enable()
+{
+    if (!map) {
+
+        map = new u8[65536];
+        clear();
+    }
+
+    enabled = true;
+    cpu.flags |= CPU_TRACK_COVERAGE;
+}
+
+void
+Coverage::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_TRACK_COVERAGE;
+}
+
+void
+Coverage::clear()
+{
+    if (map) std::memset(map, 0, 65536);
+}
+
+isize
+Coverage::count(u8 kinds) const
+{
+    isize result = 0;
+
+    if (map) {
+        for (isize i = 0; i < 65536; i++) if (map[i] & kinds) result++;
+    }
+    return result;
+}
+
+void
+Coverage::exportBitmap(std::ostream &os) const
+{
+    u8 plane[COVERAGE_PLANE_SIZE];
+
+    for (isize i = 0; i < 4; i++) os.put(char(COVERAGE_MAGIC >> (8 * i)));
+
+    for (u8 kind = COVERAGE_OPCODE; kind <= COVERAGE_WRITE; kind <<= 1) {
+
+        std::memset(plane, 0, sizeof(plane));
+
+        for (isize i = 0; map && i < 65536; i++) {
+            if (map[i] & kind) plane[i >> 3] |= u8(1 << (i & 7));
+        }
+        os.write((const char *)plane, sizeof(plane));
+    }
+}
+
+void
+Coverage::importBitmap(std::istream &is)
+{
+    u32 magic = 0;
+    u8 plane[COVERAGE_PLANE_SIZE];
+
+    for (isize i = 0; i < 4; i++) magic |= u32(u8(is.get())) << (8 * i);
+
+    if (!is || magic != COVERAGE_MAGIC) {
+        throw std::runtime_error("not a Peddle coverage map");
+    }
+
+    if (!map) {
+
+        map = new u8[65536];
+        clear();
+    }
+
+    for (u8 kind = COVERAGE_OPCODE; kind <= COVERAGE_WRITE; kind <<= 1) {
+
+        if (!is.read((char *)plane, sizeof(plane))) {
+            throw std::runtime_error("coverage map is truncated");
+        }
+        for (isize i = 0; i < 65536; i++) {
+            if (plane[i >> 3] & (1 << (i & 7))) map[i] |= kind;
+        }
+    }
+}
+
+void
+Coverage::exportListing(std::ostream &os, u16 from, u16 to) const
+{
+    auto &dasm = cpu.disassembler;
+
+    char data[16];
+    char instr[DASM_MAX_INSTR];
+    char line[128];
+
+    for (i32 addr = from; addr <= to; ) {
+
+        u8 bits = get(u16(addr));
+        isize numBytes = cpu.getLengthOfInstructionAt(u16(addr));
+        const char *count;
+        bool code = true;
+
+        if (bits & COVERAGE_OPCODE) {
+
+            // Executed instruction
+            count = "*";
+
+        } else if (bits) {
+
+            // Data or an operand which is not part of a preceding instruction
+            count = "-";
+            code = false;
+
+        } else {
+
+            // Never accessed. Disassemble it as code unless it overlaps with
+            // an accessed address.
+            count = "#####";
+            for (isize i = 1; i < numBytes; i++) {
+                if (get(u16(addr + i))) { code = false; break; }
+            }
+        }
+
+        if (code) {
+            dasm.disassemble(instr, u16(addr));
+        } else {
+            dasm.dumpByte(instr, cpu.readDasm(u16(addr)));
+            numBytes = 1;
+        }
+        dasm.dumpBytes(data, u16(addr), numBytes);
+
+        snprintf(line, sizeof(line), "%9s:  %c%c%c%c  %04X   %-9s   %s\n", count,
+                 bits & COVERAGE_OPCODE ? 'x' : '-',
+                 bits & COVERAGE_OPERAND ? 'o' : '-',
+                 bits & COVERAGE_READ ? 'r' : '-',
+                 bits & COVERAGE_WRITE ? 'w' : '-',
+                 addr, data, instr);
+        os << line;
+
+        addr += i32(numBytes);
+    }
+}
+
+}
@@ -0,0 +1,114 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <iostream>
+
+namespace peddle {
+
+// Coverage bits
+static constexpr u8 COVERAGE_OPCODE     = (1 << 0);
+static constexpr u8 COVERAGE_OPERAND    = (1 << 1);
+static constexpr u8 COVERAGE_READ       = (1 << 2);
+static constexpr u8 COVERAGE_WRITE      = (1 << 3);
+
+/* Code and data coverage
+ *
+ * The coverage map stores four bits per memory address, recording whether the
+ * address has been fetched as an opcode, fetched as an operand, read as data,
+ * or written. The bits are set in the fetch, read, and write functions of the
+ * memory interface. Idle accesses and dummy reads are not recorded.
+ *
+ * If the simple memory API is disabled, the host provides the read and write
+ * functions and is responsible for calling mark() for data accesses.
+ *
+ * The map can be exported as a binary bitmap, which stores each kind of
+ * access in a separate bit plane of 8 KB. Bitmaps can be merged, e.g., to
+ * combine the results of multiple test runs. For inspection, the map can be
+ * exported as an annotated listing, similar to the output of gcov.
+ */
+class Coverage {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Coverage bits with one entry per memory address (64K entries)
+    u8 *map = nullptr;
+
+    // Indicates whether coverage tracking is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Coverage(Peddle& ref) : cpu(ref) { }
+    ~Coverage();
+
+    void reset();
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns coverage tracking on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Clears all coverage bits
+    void clear();
+
+    // Records an access performed by the host (ignored while tracking is off)
+    void mark(u16 addr, u8 kind) { if (enabled) record(addr, kind); }
+
+private:
+
+    // Records an access performed by the CPU
+    void record(u16 addr, u8 kind) { map[addr] |= kind; }
+
+
+    //
+    // Analyzing
+    //
+
+public:
+
+    // Returns the coverage bits of a single address
+    u8 get(u16 addr) const { return map ? map[addr] : 0; }
+
+    // Returns the number of addresses with any of the given bits set
+    isize count(u8 kinds) const;
+
+
+    //
+    // Exporting
+    //
+
+public:
+
+    // Writes the coverage map as a binary bitmap
+    void exportBitmap(std::ostream &os) const;
+
+    // Merges a binary bitmap into the coverage map
+    void importBitmap(std::istream &is);
+
+    // Writes an annotated listing of a memory range
+    void exportListing(std::ostream &os, u16 from = 0, u16 to = 0xFFFF) const;
+};
+
+}
@@ -7,10 +7,13 @@
 
 #include "PeddleConfig.h"
 #include "Peddle.h"
+#include "PeddleTraceFormatter.h"
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <cassert>
+#include <stdexcept>
 
 namespace peddle {
 
@@ -82,6 +85,7 @@ Guards::setAt(u32 addr, long skip)
     guards[count].hits = 0;
     guards[count].ignore = skip;
     count++;
+    map.set(addr);
     setNeedsCheck(true);
 }
 
@@ -103,6 +107,7 @@ Guards::removeAt(u32 addr)
             break;
         }
     }
+    updateMap();
     setNeedsCheck(count != 0);
 }
 
@@ -111,6 +116,7 @@ Guards::moveTo(long nr, u32 newAddr)
 {
     if (nr >= count || isSetAt(newAddr)) return;
     guards[nr].moveTo(newAddr);
+    updateMap();
 }
 
 bool
@@ -173,16 +179,26 @@ Guards::ignore(long nr, long count)
 bool
 Guards::eval(u32 addr)
 {
+    if (!map.test(addr)) return false;
+
     for (int i = 0; i < count; i++)
         if (guards[i].eval(addr)) return true;
 
     return false;
 }
 
+void
+Guards::updateMap()
+{
+    map.clearAll();
+    for (long i = 0; i < count; i++) map.set(guards[i].addr);
+}
+
 void
 Breakpoints::setNeedsCheck(bool value)
 {
-    if (value) {
+    // Stack-based stepping relies on the breakpoint check, too
+    if (value || cpu.debugger.isStepping()) {
         cpu.flags |= CPU_CHECK_BP;
     } else {
         cpu.flags &= ~CPU_CHECK_BP;
@@ -192,22 +208,150 @@ Breakpoints::setNeedsCheck(bool value)
 void
 Watchpoints::setNeedsCheck(bool value)
 {
-    if (value) {
+    // Access triggers rely on the watchpoint check, too
+    if (value || cpu.debugger.triggers.checksAccesses()) {
         cpu.flags |= CPU_CHECK_WP;
     } else {
         cpu.flags &= ~CPU_CHECK_WP;
     }
 }
 
+//
+// Triggers
+//
+
+void
+Triggers::stopOnAccess(u32 addr)
+{
+    stopAddrs.set(addr);
+    hasStopAddrs = true;
+
+    cpu.debugger.watchpoints.setNeedsCheck(cpu.debugger.watchpoints.elements() != 0);
+}
+
+void
+Triggers::logInside(u32 from, u32 to)
+{
+    for (u32 addr = from; addr <= to && addr <= 0xFFFF; addr++) ranges.set(addr);
+    hasRanges = true;
+}
+
+void
+Triggers::removeAll()
+{
+    disarm();
+
+    startPCs.clearAll();
+    stopPCs.clearAll();
+    stopAddrs.clearAll();
+    ranges.clearAll();
+    hasStopAddrs = false;
+    hasRanges = false;
+    startCycle = INT64_MAX;
+    stopCycle = INT64_MAX;
+    preTrigger = 0;
+    postTrigger = 0;
+}
+
+void
+Triggers::arm(bool preTriggerMode)
+{
+    // Make room for the pre-trigger and post-trigger instructions
+    auto capacity = preTrigger + postTrigger + 1;
+    if (preTrigger && cpu.debugger.getLogCapacity() != capacity) {
+        cpu.debugger.setLogCapacity(capacity);
+    }
+
+    armed = true;
+    active = preTriggerMode;
+    stopping = false;
+    fired = false;
+
+    cpu.flags |= CPU_CHECK_TRIGGER;
+    cpu.debugger.watchpoints.setNeedsCheck(cpu.debugger.watchpoints.elements() != 0);
+}
+
+void
+Triggers::disarm()
+{
+    armed = false;
+
+    cpu.flags &= ~CPU_CHECK_TRIGGER;
+    cpu.debugger.watchpoints.setNeedsCheck(cpu.debugger.watchpoints.elements() != 0);
+}
+
+void
+Triggers::eval()
+{
+    u16 pc = cpu.reg.pc0;
+
+    if (!active && (startPCs.test(pc) || cpu.clock >= startCycle)) {
+
+        active = true;
+        startCycle = INT64_MAX;
+    }
+
+    if (stopPCs.test(pc) || cpu.clock >= stopCycle) stop();
+
+    // Freeze the log when the post-trigger count has been reached
+    if (stopping) {
+
+        if (countdown == 0) { freeze(); return; }
+        countdown--;
+    }
+
+    if (active && (!hasRanges || ranges.test(pc))) {
+        cpu.flags |= CPU_LOG_INSTRUCTION;
+    } else {
+        cpu.flags &= ~CPU_LOG_INSTRUCTION;
+    }
+}
+
+void
+Triggers::stop()
+{
+    if (active && !stopping) {
+
+        // The triggering instruction is logged, too
+        stopping = true;
+        countdown = postTrigger + 1;
+        stopCycle = INT64_MAX;
+    }
+}
+
+void
+Triggers::freeze()
+{
+    active = false;
+    stopping = false;
+    fired = true;
+
+    cpu.flags &= ~CPU_LOG_INSTRUCTION;
+    disarm();
+}
+
+
 //
 // Debugger
 //
 
+Debugger::Debugger(Peddle& ref) : cpu(ref)
+{
+    logBuffer = new RecordedInstruction[logCapacity];
+}
+
+Debugger::~Debugger()
+{
+    delete [] logBuffer;
+}
+
 void
 Debugger::reset()
 {
+    stepMode = STEP_NONE;
     breakpoints.setNeedsCheck(breakpoints.elements() != 0);
     watchpoints.setNeedsCheck(watchpoints.elements() != 0);
+    if (triggers.isArmed()) cpu.flags |= CPU_CHECK_TRIGGER;
     clearLog();
 }
 
@@ -224,6 +368,85 @@ Debugger::setSoftStopAtNextInstr()
     setSoftStop(cpu.getAddressOfNextInstruction());
 }
 
+void
+Debugger::stepOver()
+{
+    // Calls are stepped over by waiting for the stack to be unwound
+    auto opcode = cpu.readDasm(cpu.getPC0());
+    startStep(opcode == 0x20 || opcode == 0x00 ? STEP_OVER : STEP_INSTR);
+}
+
+void
+Debugger::stepOut()
+{
+    startStep(STEP_OUT);
+}
+
+void
+Debugger::runToReturn()
+{
+    startStep(STEP_TO_RETURN);
+}
+
+void
+Debugger::cancelStep()
+{
+    stepMode = STEP_NONE;
+    breakpoints.setNeedsCheck(breakpoints.elements() != 0);
+}
+
+void
+Debugger::startStep(StepMode mode)
+{
+    stepMode = mode;
+    stepSP = cpu.reg.sp;
+    stepIrqSP = -1;
+    breakpoints.setNeedsCheck(true);
+}
+
+bool
+Debugger::stepMatches()
+{
+    auto sp = cpu.reg.sp;
+    auto last = cpu.next;
+
+    // Skip all interrupts that have been taken while stepping
+    if (stepIrqSP >= 0) {
+
+        if (last == RTI_5 && i8(sp - u8(stepIrqSP)) > 0) stepIrqSP = -1;
+        return false;
+    }
+    if (last == irq_7 || last == nmi_7 || last == BRK_nmi_6) {
+
+        stepIrqSP = sp;
+        return false;
+    }
+
+    switch (stepMode) {
+
+        case STEP_INSTR:
+
+            return true;
+
+        case STEP_OVER:
+
+            return i8(sp - stepSP) >= 0;
+
+        case STEP_OUT:
+
+            return (last == RTS_5 || last == RTI_5) && i8(sp - stepSP) > 0;
+
+        case STEP_TO_RETURN:
+        {
+            auto opcode = cpu.readDasm(cpu.reg.pc);
+            return (opcode == 0x60 || opcode == 0x40) && i8(sp - stepSP) >= 0;
+        }
+        default:
+
+            return false;
+    }
+}
+
 bool
 Debugger::breakpointMatches(u32 addr)
 {
@@ -237,6 +460,13 @@ Debugger::breakpointMatches(u32 addr)
         return true;
     }
 
+    // Check if the stop condition of stack-based stepping is met
+    if (stepMode != STEP_NONE && stepMatches()) {
+
+        cancelStep();
+        return true;
+    }
+
     if (!breakpoints.eval(addr)) return false;
 
     breakpointPC = cpu.reg.pc;
@@ -246,6 +476,8 @@ Debugger::breakpointMatches(u32 addr)
 bool
 Debugger::watchpointMatches(u32 addr)
 {
+    if (triggers.checksAccesses()) triggers.evalAccess(addr);
+
     if (!watchpoints.eval(addr)) return false;
     
     watchpointPC = cpu.reg.pc0;
@@ -257,28 +489,9 @@ Debugger::dumpLogBuffer(std::ostream& os, isize count)
 {
     isize num = loggedInstructions();
 
-    char pc[16];
-    char instr[16];
-    char flags[16];
+    TraceFormatter formatter(cpu.disassembler, os, "   %p   %f    %i");
 
-    for (isize i = num - count; i < num ; i++) {
-
-        if (i >= 0) {
-
-            cpu.debugger.disassembleRecordedPC(i, pc);
-            cpu.debugger.disassembleRecordedInstr(i, instr);
-            cpu.debugger.disassembleRecordedFlags(i, flags);
-
-            os << std::setfill('0');
-            os << "   ";
-            os << std::right << std::setw(4) << pc;
-            os << "   ";
-            os << flags;
-            os << "    ";
-            os << instr;
-            os << std::endl;
-        }
-    }
+    for (isize i = std::max(num - count, isize(0)); i < num; i++) formatter << logEntryAbs(i);
 }
 
 void
@@ -299,10 +512,22 @@ Debugger::disableLogging()
     cpu.flags &= ~CPU_LOG_INSTRUCTION;
 }
 
+void
+Debugger::setLogCapacity(isize capacity)
+{
+    if (capacity < 1) throw std::runtime_error("invalid log capacity");
+
+    auto *buffer = new RecordedInstruction[capacity];
+    delete [] logBuffer;
+    logBuffer = buffer;
+    logCapacity = capacity;
+    clearLog();
+}
+
 isize
 Debugger::loggedInstructions() const
 {
-    return logCnt < LOG_BUFFER_CAPACITY ? logCnt : LOG_BUFFER_CAPACITY;
+    return logCnt < logCapacity ? logCnt : logCapacity;
 }
 
 void
@@ -312,7 +537,7 @@ Debugger::logInstruction()
     u8 opcode = cpu.readDasm(pc);
     isize length = cpu.getLengthOfInstruction(opcode);
 
-    isize i = logCnt++ % LOG_BUFFER_CAPACITY;
+    isize i = logCnt++ % logCapacity;
     
     logBuffer[i].cycle = cpu.clock;
     logBuffer[i].pc = pc;
@@ -330,7 +555,7 @@ const RecordedInstruction &
 Debugger::logEntryRel(isize n) const
 {
     assert(n < loggedInstructions());
-    return logBuffer[(logCnt - 1 - n) % LOG_BUFFER_CAPACITY];
+    return logBuffer[(logCnt - 1 - n) % logCapacity];
 }
 
 const RecordedInstruction &
@@ -344,7 +569,7 @@ u16
 Debugger::loggedPC0Rel(isize n) const
 {
     assert(n < loggedInstructions());
-    return logBuffer[(logCnt - 1 - n) % LOG_BUFFER_CAPACITY].pc;
+    return logBuffer[(logCnt - 1 - n) % logCapacity].pc;
 }
 
 u16
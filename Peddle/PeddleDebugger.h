@@ -57,6 +57,9 @@ protected:
     // Number of currently stored guards
     long count = 0;
 
+    // Addresses of all stored guards
+    AddressMap map;
+
     // Indicates if guard checking is necessary
     virtual void setNeedsCheck(bool value) = 0;
     
@@ -94,7 +97,7 @@ public:
 
     void remove(long nr);
     void removeAt(u32 addr);
-    void removeAll() { count = 0; setNeedsCheck(false); }
+    void removeAll() { count = 0; map.clearAll(); setNeedsCheck(false); }
 
 
     //
@@ -129,6 +132,9 @@ private:
     
     // Returns true if the guard hits
     bool eval(u32 addr);
+
+    // Recomputes the address bitmap
+    void updateMap();
 };
 
 class Breakpoints : public Guards {
@@ -147,6 +153,138 @@ public:
     void setNeedsCheck(bool value) override;
 };
 
+/* Trace triggers
+ *
+ * Triggers control instruction logging. A start trigger turns logging on
+ * and a stop trigger turns it off after a configurable number of additional
+ * instructions (post-trigger count). Triggers fire when a certain instruction
+ * is executed, when a certain address is accessed, or when the clock reaches
+ * a certain cycle. In addition, logging can be restricted to a set of address
+ * ranges.
+ *
+ * In pre-trigger mode, logging is active from the beginning and the log
+ * buffer keeps running until a stop trigger fires. Afterwards, the buffer is
+ * frozen and contains the instructions leading up to the trigger event. How
+ * many of them are kept is determined by the capacity of the log buffer.
+ * If a pre-trigger count is set, arm() resizes the log buffer such that it
+ * holds this number of instructions plus the triggering instruction and the
+ * post-trigger instructions.
+ *
+ * Instruction addresses are looked up in address bitmaps, similar to guards.
+ * Access triggers are evaluated in the watchpoint path. Until the triggers
+ * have been armed, they cause no overhead.
+ */
+class Triggers {
+
+    friend class Peddle;
+    friend class Debugger;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Instruction addresses that start or stop logging
+    AddressMap startPCs;
+    AddressMap stopPCs;
+
+    // Memory addresses that stop logging when accessed
+    AddressMap stopAddrs;
+    bool hasStopAddrs = false;
+
+    // Instruction addresses inside the logged ranges
+    AddressMap ranges;
+    bool hasRanges = false;
+
+    // Cycles that start or stop logging
+    i64 startCycle = INT64_MAX;
+    i64 stopCycle = INT64_MAX;
+
+    // Number of instructions kept before a stop trigger has fired (0 = any)
+    isize preTrigger = 0;
+
+    // Number of instructions logged after a stop trigger has fired
+    isize postTrigger = 0;
+
+    // Trigger state
+    bool armed = false;
+    bool active = false;
+    bool stopping = false;
+    bool fired = false;
+    isize countdown = 0;
+
+
+    //
+    // Constructing
+    //
+
+public:
+
+    Triggers(Peddle& ref) : cpu(ref) { }
+
+
+    //
+    // Configuring
+    //
+
+public:
+
+    // Starts or stops logging when the instruction at the given address executes
+    void startAt(u32 pc) { startPCs.set(pc); }
+    void stopAt(u32 pc) { stopPCs.set(pc); }
+
+    // Stops logging when the given address is accessed
+    void stopOnAccess(u32 addr);
+
+    // Starts or stops logging at the given cycle
+    void startAtCycle(i64 cycle) { startCycle = cycle; }
+    void stopAtCycle(i64 cycle) { stopCycle = cycle; }
+
+    // Restricts logging to instructions inside an address range
+    void logInside(u32 from, u32 to);
+
+    // Sets the number of instructions kept before a stop trigger has fired
+    void setPreTrigger(isize count) { preTrigger = count; }
+
+    // Sets the number of instructions logged after a stop trigger has fired
+    void setPostTrigger(isize count) { postTrigger = count; }
+
+    // Removes all triggers and disarms
+    void removeAll();
+
+
+    //
+    // Running
+    //
+
+public:
+
+    // Activates all triggers
+    void arm(bool preTriggerMode = false);
+    void disarm();
+
+    // Returns true if the triggers are armed
+    bool isArmed() const { return armed; }
+
+    // Returns true if a stop trigger has fired and the log has been frozen
+    bool hasFired() const { return fired; }
+
+    // Returns true if memory accesses need to be checked
+    bool checksAccesses() const { return armed && hasStopAddrs; }
+
+private:
+
+    // Called at the end of each instruction while the triggers are armed
+    void eval();
+
+    // Called for each memory access while the triggers are armed
+    void evalAccess(u32 addr) { if (stopAddrs.test(addr)) stop(); }
+
+    // Fires a stop trigger
+    void stop();
+
+    // Stops logging and disarms
+    void freeze();
+};
+
 class Debugger {
     
     friend class Peddle;
@@ -156,14 +294,20 @@ class Debugger {
     
 public:
     
-    // Log buffer
-    RecordedInstruction logBuffer[LOG_BUFFER_CAPACITY];
+    // Log buffer (ring buffer)
+    RecordedInstruction *logBuffer = nullptr;
+
+    // Number of entries in the log buffer
+    isize logCapacity = LOG_BUFFER_CAPACITY;
 
     // Breakpoint storage
     Breakpoints breakpoints = Breakpoints(cpu);
 
     // Watchpoint storage (not yet supported)
     Watchpoints watchpoints = Watchpoints(cpu);
+
+    // Trace triggers
+    Triggers triggers = Triggers(cpu);
     
     // Saved program counters
     i32 breakpointPC = -1;
@@ -188,6 +332,20 @@ private:
      */
     u64 softStop = UINT64_MAX - 1;
 
+    /* Stack-based stepping.
+     * Soft stops are unaware of the call structure. E.g., a soft stop placed
+     * behind a JSR instruction triggers too early if the subroutine recurses
+     * and never triggers if the subroutine returns elsewhere. Stack-based
+     * stepping records the stack pointer when stepping starts and compares it
+     * with the current stack pointer at the end of each instruction. In
+     * addition, interrupts taken while stepping are skipped. The stack
+     * pointer right after the interrupt frame has been pushed is kept in
+     * stepIrqSP until the matching RTI has been executed.
+     */
+    StepMode stepMode = STEP_NONE;
+    u8 stepSP = 0;
+    i32 stepIrqSP = -1;
+
     
     //
     // Initializing
@@ -195,7 +353,8 @@ private:
     
 public:
     
-    Debugger(Peddle& ref) : cpu(ref) { };
+    Debugger(Peddle& ref);
+    ~Debugger();
     void reset();
 
     
@@ -208,12 +367,35 @@ public:
     // Sets a soft breakpoint
     void setSoftStop(u64 addr);
     void setSoftStopAtNextInstr();
+
+    // Executes the next instruction or subroutine call (JSR, BRK)
+    void stepOver();
+
+    // Runs until the current routine has returned
+    void stepOut();
+
+    // Runs until the return instruction of the current routine is reached
+    void runToReturn();
+
+    // Cancels stack-based stepping
+    void cancelStep();
+    bool isStepping() const { return stepMode != STEP_NONE; }
     
     // Returns true if a breakpoint hits at the provides address
     bool breakpointMatches(u32 addr);
 
     // Returns true if a watchpoint hits at the provides address
     bool watchpointMatches(u32 addr);
+
+private:
+
+    // Starts stack-based stepping
+    void startStep(StepMode mode);
+
+    // Returns true if the stop condition of stack-based stepping is met
+    bool stepMatches();
+
+public:
     
     
     //
@@ -228,6 +410,10 @@ public:
     void enableLogging();
     void disableLogging();
 
+    // Returns or changes the capacity of the log buffer (clears the log)
+    isize getLogCapacity() const { return logCapacity; }
+    void setLogCapacity(isize capacity);
+
     // Returns the number of logged instructions
     isize loggedInstructions() const;
     
@@ -8,9 +8,39 @@
 #pragma once
 
 #include "PeddleTypes.h"
+#include <cstring>
 
 namespace peddle {
 
+peddle_enum_long(STEP_MODE)
+{
+    STEP_NONE,          // No stack-based stepping
+    STEP_INSTR,         // Stop at the next instruction of the current context
+    STEP_OVER,          // Stop when the stack is back at the recorded level
+    STEP_OUT,           // Stop when the current routine has returned
+    STEP_TO_RETURN      // Stop at the return instruction of the current routine
+};
+typedef STEP_MODE StepMode;
+
+/* Address bitmap
+ *
+ * The bitmap stores a single bit for each address of the 64 KB address space.
+ * It is used to quickly rule out addresses in hot paths such as the guard
+ * and trigger checks. Addresses beyond 0xFFFF share the bit of their lower
+ * 16 bits.
+ */
+struct AddressMap {
+
+    u64 bits[1024];
+
+    AddressMap() { clearAll(); }
+
+    void set(u32 addr) { bits[(addr >> 6) & 1023] |= u64(1) << (addr & 63); }
+    void clear(u32 addr) { bits[(addr >> 6) & 1023] &= ~(u64(1) << (addr & 63)); }
+    void clearAll() { std::memset(bits, 0, sizeof(bits)); }
+    bool test(u32 addr) const { return (bits[(addr >> 6) & 1023] >> (addr & 63)) & 1; }
+};
+
 // Base structure for a single breakpoint or watchpoint
 struct Guard {
 
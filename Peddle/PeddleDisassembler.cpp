@@ -10,6 +10,9 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 
 namespace peddle {
@@ -23,6 +26,17 @@ Disassembler::Disassembler(Peddle& ref) : cpu(ref)
     };
 }
 
+Disassembler::~Disassembler()
+{
+    delete [] cache;
+}
+
+void
+Disassembler::reset()
+{
+    flushCache();
+}
+
 void
 Disassembler::setNumberFormat(DasmNumberFormat instrFormat, DasmNumberFormat dataFormat)
 {
@@ -38,6 +52,7 @@ Disassembler::setNumberFormat(DasmNumberFormat instrFormat, DasmNumberFormat dat
 
     instrStyle.numberFormat = instrFormat;
     dataStyle.numberFormat = dataFormat;
+    updateTables();
 }
 
 void
@@ -45,33 +60,201 @@ Disassembler::setIndentation(int value)
 {
     instrStyle.tab = value;
     dataStyle.tab = value;
+    updateTables();
 }
 
-isize
-Disassembler::disass(char *dst, const char *fmt, u16 addr) const
+void
+Disassembler::updateTables()
 {
-    auto instr = RecordedInstruction {
+    updateTable(instrBytes, instrStyle);
+    updateTable(dataBytes, dataStyle);
+    flushCache();
+
+    for (isize i = 0; i < 256 && instrBytes.valid; i++) {
+
+        auto &t = templates[i];
+        const char *open = "", *close = "";
+        t.operand = 1;
+        t.symbolic = true;
+
+        switch (cpu.addressingMode[i]) {
+
+            case ADDR_IMMEDIATE:    open = "#"; t.symbolic = false; break;
+            case ADDR_ZERO_PAGE:    break;
+            case ADDR_ZERO_PAGE_X:  close = ",X"; break;
+            case ADDR_ZERO_PAGE_Y:  close = ",Y"; break;
+            case ADDR_ABSOLUTE:     t.operand = 2; break;
+            case ADDR_ABSOLUTE_X:   t.operand = 2; close = ",X"; break;
+            case ADDR_ABSOLUTE_Y:   t.operand = 2; close = ",Y"; break;
+            case ADDR_DIRECT:       t.operand = 2; break;
+            case ADDR_INDIRECT:     t.operand = 2; open = "("; close = ")"; break;
+            case ADDR_INDIRECT_X:   open = "("; close = ",X)"; break;
+            case ADDR_INDIRECT_Y:   open = "("; close = "),Y"; break;
+            case ADDR_RELATIVE:     t.operand = 3; break;
 
-        .byte1 = cpu.readDasm(addr),
-        .byte2 = cpu.readDasm(addr + 1),
-        .byte3 = cpu.readDasm(addr + 2),
-        .pc = addr
+            default:
+                t.operand = 0;
+        }
+
+        // Mnemonic, followed by the indentation and the opening characters
+        isize len = 0;
+        for (isize j = 0; j < 3; j++) t.head[len++] = Peddle::mnemonic[i][j];
+        if (t.operand) {
+
+            isize width = std::max(isize(instrStyle.tab), isize(4));
+            if (width + isize(strlen(open)) >= isize(sizeof(t.head))) { instrBytes.valid = false; break; }
+
+            while (len < width) t.head[len++] = ' ';
+            for (isize j = 0; open[j]; j++) t.head[len++] = open[j];
+        }
+        t.headLen = u8(len);
+
+        // Closing characters
+        for (len = 0; close[len]; len++) t.tail[len] = close[len];
+        t.tailLen = u8(len);
+    }
+}
+
+void
+Disassembler::updateTable(ByteTable &table, const DasmStyle &style)
+{
+    auto prefix = style.numberFormat.prefix;
+
+    table.style = style;
+    table.valid = strlen(prefix) < sizeof(table.prefix);
+    if (!table.valid) return;
+
+    strcpy(table.prefix, prefix);
+
+    for (isize i = 0; i < 256; i++) {
+
+        char tmp[32];
+        StrWriter writer(tmp, style);
+        writer << u8(i);
+
+        auto len = writer.length();
+        if (len >= isize(sizeof(table.text[i]))) { table.valid = false; return; }
+
+        memcpy(table.text[i], tmp, len);
+        table.length[i] = u8(len);
+    }
+
+    // Without a prefix, zero-filled hexadecimal words are composed of two bytes
+    auto &fmt = style.numberFormat;
+    table.pairs = fmt.radix == 16 && fmt.fill == '0' && prefix[0] == 0;
+}
+
+bool
+Disassembler::matches(const ByteTable &table, const DasmStyle &style) const
+{
+    auto &f1 = table.style.numberFormat;
+    auto &f2 = style.numberFormat;
+
+    return
+    table.valid &&
+    table.style.tab == style.tab &&
+    f1.radix == f2.radix &&
+    f1.upperCase == f2.upperCase &&
+    f1.fill == f2.fill &&
+    f1.plainZero == f2.plainZero &&
+    strcmp(table.prefix, f2.prefix) == 0;
+}
+
+void
+Disassembler::enableCache()
+{
+    if (!cache) cache = new CacheEntry[cacheSize];
+    flushCache();
+
+    cacheEnabled = true;
+}
+
+void
+Disassembler::disableCache()
+{
+    cacheEnabled = false;
+}
+
+void
+Disassembler::flushCache() const
+{
+    if (!cache) return;
+
+    for (isize i = 0; i < cacheSize; i++) cache[i].textLen = 0;
+    cachedSymbols = symbols.version();
+}
+
+const Disassembler::CacheEntry *
+Disassembler::lookup(u16 addr) const
+{
+    // The cache only holds output produced by the fast path
+    if (!cacheEnabled || !matches(instrBytes, instrStyle)) return nullptr;
+
+    if (cachedSymbols != symbols.version()) flushCache();
+
+    // The fast path writes a template, a label or number, and a tail
+    static_assert(sizeof(Template::head) + SYMBOL_MAX_LENGTH + sizeof(Template::tail) <= sizeof(CacheEntry::text));
+
+    auto &entry = cache[addr & (cacheSize - 1)];
+    u8 bytes[3] = { cpu.readDasm(addr), cpu.readDasm(u16(addr + 1)), cpu.readDasm(u16(addr + 2)) };
+
+    // Only compare the bytes the instruction consists of
+    auto valid = [&]() {
+
+        if (entry.addr != addr || entry.textLen == 0) return false;
+        for (isize i = 0; i < entry.length; i++) if (entry.bytes[i] != bytes[i]) return false;
+        return true;
     };
 
-    return disass(dst, fmt, instr);
+    if (!valid()) {
+
+        auto len = writeInstr(entry.text, addr, bytes[0], bytes[1], bytes[2]);
+
+        entry.addr = addr;
+        memcpy(entry.bytes, bytes, sizeof(bytes));
+        entry.length = u8(cpu.getLengthOfInstruction(bytes[0]));
+        entry.textLen = u8(len);
+    }
+
+    return &entry;
 }
 
-isize
-Disassembler::disass(char *dst, const char *fmt, const RecordedInstruction &instr) const
+void
+Disassembler::copyCached(char *dst, const CacheEntry &entry)
 {
+    // The texts are short, which makes a plain loop faster than memcpy
+    const char *src = entry.text;
+    while ((*dst++ = *src++)) { }
+}
+
+DasmFormat
+Disassembler::compile(const char *fmt)
+{
+    DasmFormat result;
+
     bool ctrl = false;
     isize tab = 0;
+    isize text = 0;
+
+    auto addOp = [&](char kind, isize tab) {
+
+        if (result.count == DasmFormat::maxOps || tab > 255) {
+            throw std::runtime_error("format string too complex");
+        }
+        result.ops[result.count++] = DasmFormat::Op { kind, u8(tab), u8(text), 0 };
+    };
 
     for (char c = fmt[0]; c != 0; c = (++fmt)[0]) {
 
         if (!ctrl) {
 
-            if (c == '%') { ctrl = true; tab = 0; } else *dst++ = c;
+            if (c == '%') { ctrl = true; tab = 0; continue; }
+
+            // Append the character to the current text operation
+            if (result.count == 0 || result.ops[result.count - 1].kind != 0) addOp(0, 0);
+            if (text == DasmFormat::maxText) throw std::runtime_error("format string too long");
+            result.text[text++] = c;
+            result.ops[result.count - 1].length++;
             continue;
         }
 
@@ -83,60 +266,161 @@ Disassembler::disass(char *dst, const char *fmt, const RecordedInstruction &inst
 
         switch (c) {
 
+            case 'p': case 'a': case 'x': case 'y': case 's': case 'b': case 'i': case 'f': case 'c':
+
+                addOp(c, tab);
+                break;
+
+            default:
+                throw std::runtime_error("invalid format string");
+        }
+
+        ctrl = false;
+    }
+
+    // Reject a dangling control character
+    if (ctrl) throw std::runtime_error("invalid format string");
+
+    return result;
+}
+
+isize
+Disassembler::disass(char *dst, const char *fmt, u16 addr) const
+{
+    auto instr = RecordedInstruction {
+
+        .byte1 = cpu.readDasm(addr),
+        .byte2 = cpu.readDasm(addr + 1),
+        .byte3 = cpu.readDasm(addr + 2),
+        .pc = addr
+    };
+
+    return disass(dst, fmt, instr);
+}
+
+isize
+Disassembler::disass(char *dst, const char *fmt, const RecordedInstruction &instr) const
+{
+    return disass(dst, compile(fmt), instr);
+}
+
+isize
+Disassembler::disass(char *dst, const DasmFormat &fmt, const RecordedInstruction &instr) const
+{
+    *writeRecord(dst, fmt, instr) = 0;
+
+    return cpu.getLengthOfInstruction(cpu.readDasm(instr.pc));
+}
+
+char *
+Disassembler::writeRecord(char *dst, const DasmFormat &fmt, const RecordedInstruction &instr) const
+{
+    for (isize i = 0; i < fmt.count; i++) {
+
+        auto &op = fmt.ops[i];
+
+        switch (op.kind) {
+
+            case 0: // Literal text
+
+                memcpy(dst, fmt.text + op.offset, op.length);
+                dst += op.length;
+                break;
+
             case 'p': // Program counter (instruction address)
 
-                dst += disass16(instr.pc, dst, tab);
+                dst += disass16(instr.pc, dst, op.tab);
                 break;
 
             case 'a': // Accumulator
 
-                dst += disass8(instr.a, dst, tab);
+                dst += disass8(instr.a, dst, op.tab);
                 break;
 
             case 'x': // X register
 
-                dst += disass8(instr.x, dst, tab);
+                dst += disass8(instr.x, dst, op.tab);
                 break;
 
             case 'y': // Y register
 
-                dst += disass8(instr.y, dst, tab);
+                dst += disass8(instr.y, dst, op.tab);
                 break;
 
             case 's': // Stack pointer
 
-                dst += disass8(instr.sp, dst, tab);
+                dst += disass8(instr.sp, dst, op.tab);
                 break;
 
             case 'b': // Instruction bytes (1 - 3)
 
-                dst += disassB(instr.byte1, instr.byte2, instr.byte3, dst, tab);
+                dst += disassB(instr.byte1, instr.byte2, instr.byte3, dst, op.tab);
                 break;
 
             case 'i': // Disassembled instruction
 
-                dst += disassI(instr.pc, instr.byte1, instr.byte2, instr.byte3, dst, tab);
+                dst += disassI(instr.pc, instr.byte1, instr.byte2, instr.byte3, dst, op.tab);
                 break;
 
             case 'f': // Flags
 
-                dst += disassF(instr.flags, dst, tab);
+                dst += disassF(instr.flags, dst, op.tab);
                 break;
 
-            default:
-                fatalError;
+            case 'c': // Cycle (always decimal)
+
+                dst += disassC(instr.cycle, dst, op.tab);
+                break;
         }
+    }
 
-        ctrl = false;
+    return dst;
+}
+
+isize
+Disassembler::maxLength(const DasmFormat &fmt) const
+{
+    // Numbers have at most five digits or fill characters and a prefix
+    isize data = isize(strlen(dataStyle.numberFormat.prefix)) + 5;
+    isize code = isize(strlen(instrStyle.numberFormat.prefix)) + 5;
+
+    // Mnemonic and indentation, an opening bracket, the operand, and ",X)"
+    isize instr = std::max(isize(instrStyle.tab), isize(4)) + 1 + std::max(code, SYMBOL_MAX_LENGTH) + 3;
+
+    isize result = 0;
+
+    for (isize i = 0; i < fmt.count; i++) {
+
+        auto &op = fmt.ops[i];
+        isize len = 0;
+
+        switch (op.kind) {
+
+            case 0:     len = op.length; break;
+            case 'p':
+            case 'a':
+            case 'x':
+            case 'y':
+            case 's':   len = data; break;
+            case 'b':   len = 3 * data + 2; break;
+            case 'i':   len = instr; break;
+            case 'f':   len = 8; break;
+            case 'c':   len = 20; break;
+        }
+        result += std::max(len, isize(op.tab));
     }
-    *dst = 0;
 
-    return cpu.getLengthOfInstruction(cpu.readDasm(instr.pc));
+    return result;
 }
 
 isize
 Disassembler::disass(char *dst, u16 addr) const
 {
+    if (auto entry = lookup(addr)) {
+
+        copyCached(dst, *entry);
+        return entry->length;
+    }
     return disass(dst, "%i", addr);
 }
 
@@ -149,72 +433,54 @@ Disassembler::disass(char *dst, const RecordedInstruction &instr) const
 isize
 Disassembler::disass8(u8 value, char *dst, isize tab) const
 {
-    StrWriter writer(dst, dataStyle);
-
-    writer << value;
-    writer.fill(tab);
+    isize len = writeByte(dst, value);
+    while (len < tab) dst[len++] = ' ';
 
-    return writer.length();
+    return len;
 }
 
 isize
 Disassembler::disass16(u16 value, char *dst, isize tab) const
 {
-    StrWriter writer(dst, dataStyle);
-
-    writer << value;
-    writer.fill(tab);
+    isize len = writeWord(dst, dataBytes, dataStyle, value);
+    while (len < tab) dst[len++] = ' ';
 
-    return writer.length();
+    return len;
 }
 
 isize
 Disassembler::disassB(u8 byte1, u8 byte2, u8 byte3, char *dst, isize tab) const
 {
-    StrWriter writer(dst, dataStyle);
-
     auto count = cpu.getLengthOfInstruction(byte1);
 
-    writer << byte1;
-    if (count > 1) writer << ' ' << byte2;
-    if (count > 2) writer << ' ' << byte3;
-    writer.fill(tab);
+    isize len = writeByte(dst, byte1);
+    if (count > 1) { dst[len++] = ' '; len += writeByte(dst + len, byte2); }
+    if (count > 2) { dst[len++] = ' '; len += writeByte(dst + len, byte3); }
+    while (len < tab) dst[len++] = ' ';
 
-    return writer.length();
+    return len;
 }
 
 isize
 Disassembler::disassI(u16 addr, u8 byte1, u8 byte2, u8 byte3, char *dst, isize tab) const
 {
-    StrWriter writer(dst, instrStyle);
-
-    // Write mnemonic
-    writer << Ins { byte1 };
-
-    // Write operand
-    switch (cpu.addressingMode[byte1]) {
+    isize len = writeInstr(dst, addr, byte1, byte2, byte3);
+    while (len < tab) dst[len++] = ' ';
 
-        case ADDR_IMMEDIATE:    writer << Tab{} << Imm  { byte2 }; break;
-        case ADDR_ZERO_PAGE:    writer << Tab{} << Zp   { byte2 }; break;
-        case ADDR_ZERO_PAGE_X:  writer << Tab{} << Zpx  { byte2 }; break;
-        case ADDR_ZERO_PAGE_Y:  writer << Tab{} << Zpy  { byte2 }; break;
-        case ADDR_ABSOLUTE:     writer << Tab{} << Abs  { LO_HI(byte2, byte3) }; break;
-        case ADDR_ABSOLUTE_X:   writer << Tab{} << Absx { LO_HI(byte2, byte3) }; break;
-        case ADDR_ABSOLUTE_Y:   writer << Tab{} << Absy { LO_HI(byte2, byte3) }; break;
-        case ADDR_DIRECT:       writer << Tab{} << Dir  { LO_HI(byte2, byte3) }; break;
-        case ADDR_INDIRECT:     writer << Tab{} << Ind  { LO_HI(byte2, byte3) }; break;
-        case ADDR_INDIRECT_X:   writer << Tab{} << Indx { byte2 }; break;
-        case ADDR_INDIRECT_Y:   writer << Tab{} << Indy { byte2 }; break;
-        case ADDR_RELATIVE:     writer << Tab{} << Rel  { (u16)(addr + 2 + (i8)byte2) }; break;
+    return len;
+}
 
-        default:
-            break;
-    }
+isize
+Disassembler::disassC(u64 cycle, char *dst, isize tab) const
+{
+    char digits[20];
+    isize len = 0;
 
-    writer << Fin{};
-    writer.fill(tab);
+    do { digits[len++] = char('0' + cycle % 10); cycle /= 10; } while (cycle);
+    for (isize i = 0; i < len; i++) dst[i] = digits[len - 1 - i];
+    while (len < tab) dst[len++] = ' ';
 
-    return writer.length();
+    return len;
 }
 
 isize
@@ -235,6 +501,11 @@ Disassembler::disassF(u8 flags, char *dst, isize tab) const
 isize
 Disassembler::disassemble(char *str, u16 addr) const
 {
+    if (auto entry = lookup(addr)) {
+
+        copyCached(str, *entry);
+        return entry->length;
+    }
     return disassemble(str,
                        addr,
                        cpu.readDasm(addr),
@@ -245,7 +516,64 @@ Disassembler::disassemble(char *str, u16 addr) const
 isize
 Disassembler::disassemble(char *str, u16 pc, u8 byte1, u8 byte2, u8 byte3) const
 {
-    StrWriter writer(str, instrStyle);
+    writeInstr(str, pc, byte1, byte2, byte3);
+    return cpu.getLengthOfInstruction(byte1);
+}
+
+isize
+Disassembler::writeInstr(char *dst, u16 pc, u8 byte1, u8 byte2, u8 byte3) const
+{
+    if (matches(instrBytes, instrStyle)) {
+
+        auto &t = templates[byte1];
+        char *p = dst;
+
+        memcpy(p, t.head, t.headLen);
+        p += t.headLen;
+
+        // Substitute a label for the operand if one exists
+        const char *label = nullptr;
+        if (t.symbolic && !symbols.isEmpty()) {
+
+            switch (t.operand) {
+
+                case 1: label = symbols.lookup(byte2); break;
+                case 2: label = symbols.lookup(LO_HI(byte2, byte3)); break;
+                case 3: label = symbols.lookup(u16(pc + 2 + (i8)byte2)); break;
+            }
+        }
+
+        if (label) {
+
+            for (isize i = 0; i < SYMBOL_MAX_LENGTH && label[i]; i++) *p++ = label[i];
+
+        } else switch (t.operand) {
+
+            case 1:
+
+                memcpy(p, instrBytes.text[byte2], instrBytes.length[byte2]);
+                p += instrBytes.length[byte2];
+                break;
+
+            case 2:
+
+                p += writeWord(p, instrBytes, instrStyle, LO_HI(byte2, byte3));
+                break;
+
+            case 3:
+
+                p += writeWord(p, instrBytes, instrStyle, u16(pc + 2 + (i8)byte2));
+                break;
+        }
+
+        memcpy(p, t.tail, t.tailLen);
+        p += t.tailLen;
+        *p = 0;
+
+        return isize(p - dst);
+    }
+
+    StrWriter writer(dst, instrStyle, symbols.isEmpty() ? nullptr : &symbols);
 
     // Write mnemonic
     writer << Ins { byte1 };
@@ -273,7 +601,38 @@ Disassembler::disassemble(char *str, u16 pc, u8 byte1, u8 byte2, u8 byte3) const
     // Terminate the string
     writer << Fin{};
 
-    return cpu.getLengthOfInstruction(byte1);
+    return writer.length();
+}
+
+isize
+Disassembler::writeByte(char *dst, u8 value) const
+{
+    if (matches(dataBytes, dataStyle)) {
+
+        memcpy(dst, dataBytes.text[value], dataBytes.length[value]);
+        dst[dataBytes.length[value]] = 0;
+        return dataBytes.length[value];
+    }
+
+    StrWriter writer(dst, dataStyle);
+    writer << value << Fin{};
+    return writer.length();
+}
+
+isize
+Disassembler::writeWord(char *dst, const ByteTable &table, const DasmStyle &style, u16 value) const
+{
+    if (table.pairs && matches(table, style)) {
+
+        memcpy(dst, table.text[HI_BYTE(value)], 2);
+        memcpy(dst + 2, table.text[LO_BYTE(value)], 2);
+        return 4;
+    }
+
+    // Other styles may pad and prefix words differently than bytes
+    StrWriter writer(dst, style);
+    writer << value;
+    return writer.length();
 }
 
 void
@@ -301,39 +660,35 @@ Disassembler::disassembleFlags(char *str) const
 void
 Disassembler::dumpByte(char *str, u8 value) const
 {
-    StrWriter(str, dataStyle) << value << '\0';
+    writeByte(str, value);
 }
 
 void
 Disassembler::dumpWord(char *str, u16 value) const
 {
-    StrWriter(str, dataStyle) << value << '\0';
+    str[writeWord(str, dataBytes, dataStyle, value)] = 0;
 }
 
 void
 Disassembler::dumpBytes(char *str, u32 addr, isize cnt) const
 {
-    StrWriter writer(str, dataStyle);
-
     for (isize i = 0; i < cnt; i++) {
 
-        if (i) writer << " ";
-        writer << cpu.readDasm(U16_ADD(addr, i));
+        if (i) *str++ = ' ';
+        str += writeByte(str, cpu.readDasm(U16_ADD(addr, i)));
     }
-    writer << '\0';
+    *str = 0;
 }
 
 void
 Disassembler::dumpBytes(char *str, u8 values[], isize cnt) const
 {
-    StrWriter writer(str, dataStyle);
-
     for (isize i = 0; i < cnt; i++) {
 
-        if (i) writer << " ";
-        writer << values[i];
+        if (i) *str++ = ' ';
+        str += writeByte(str, values[i]);
     }
-    writer << '\0';
+    *str = 0;
 }
 
 void
@@ -373,7 +728,7 @@ void
 Disassembler::disassembleRange(std::ostream& os, std::pair<u16, u16> range, isize max)
 {
     char data[16];
-    char instr[16];
+    char instr[DASM_MAX_INSTR];
     char address[16];
 
     u16 addr = range.first;
@@ -412,4 +767,109 @@ Disassembler::disassembleRange(std::ostream& os, std::pair<u16, u16> range, isiz
     }
 }
 
+isize
+Disassembler::disassembleRange(DasmRecord *dst, isize capacity,
+                               std::pair<u16, u16> range, isize threads) const
+{
+    if (range.first > range.second || capacity <= 0) return 0;
+
+    // Take a snapshot of the range (plus two bytes for the last instruction)
+    isize size = isize(range.second) - isize(range.first) + 1;
+    std::vector<u8> mem(size + 2);
+    for (isize i = 0; i < size + 2; i++) mem[i] = cpu.readDasm(u16(range.first + i));
+
+    // Split the range into instructions
+    u8 length[256];
+    for (isize i = 0; i < 256; i++) length[i] = u8(cpu.getLengthOfInstruction(u8(i)));
+
+    isize count = 0;
+    for (isize i = 0; i < size && count < capacity; i += length[mem[i]], count++) {
+
+        auto &rec = dst[count];
+        rec.addr = u16(range.first + i);
+        rec.length = length[mem[i]];
+        rec.bytes[0] = mem[i];
+        rec.bytes[1] = mem[i + 1];
+        rec.bytes[2] = mem[i + 2];
+    }
+
+    // Format the records
+    if (threads <= 0) threads = isize(std::thread::hardware_concurrency());
+    threads = std::max(isize(1), std::min(threads, count / 1024));
+
+    std::vector<std::thread> workers;
+    for (isize t = 1; t < threads; t++) {
+
+        isize first = count * t / threads;
+        isize last = count * (t + 1) / threads;
+        workers.emplace_back([this, dst, first, last]() {
+            formatRecords(dst + first, last - first);
+        });
+    }
+    formatRecords(dst, count / threads);
+    for (auto &worker : workers) worker.join();
+
+    return count;
+}
+
+isize
+Disassembler::disassembleAround(DasmRecord *dst, u16 addr, isize before, isize after) const
+{
+    if (before < 0 || after < 0) return 0;
+
+    // Determine the preceding instructions
+    std::vector<u16> trail(before);
+    cpu.boundaries.rewind(addr, before, trail.data());
+
+    isize count = 0;
+    auto add = [&](u16 pc) {
+
+        auto &rec = dst[count++];
+        rec.addr = pc;
+        rec.bytes[0] = cpu.readDasm(pc);
+        rec.bytes[1] = cpu.readDasm(u16(pc + 1));
+        rec.bytes[2] = cpu.readDasm(u16(pc + 2));
+        rec.length = u8(cpu.getLengthOfInstruction(rec.bytes[0]));
+    };
+
+    for (isize i = before - 1; i >= 0; i--) add(trail[i]);
+    for (isize i = 0; i < after; i++) {
+        add(i ? U16_ADD(dst[count - 1].addr, dst[count - 1].length) : addr);
+    }
+
+    formatRecords(dst, count);
+    return count;
+}
+
+void
+Disassembler::formatRecords(DasmRecord *dst, isize count) const
+{
+    char tmp[128];
+
+    auto copy = [&](char *to, isize size, isize len) {
+        if (len > size - 1) len = size - 1;
+        memcpy(to, tmp, len);
+        to[len] = 0;
+    };
+
+    for (isize i = 0; i < count; i++) {
+
+        auto &rec = dst[i];
+
+        auto len = writeInstr(tmp, rec.addr, rec.bytes[0], rec.bytes[1], rec.bytes[2]);
+        copy(rec.instr, sizeof(rec.instr), len);
+
+        len = writeByte(tmp, rec.bytes[0]);
+        for (isize j = 1; j < rec.length; j++) {
+            tmp[len++] = ' ';
+            len += writeByte(tmp + len, rec.bytes[j]);
+        }
+        copy(rec.data, sizeof(rec.data), len);
+
+        StrWriter writer(tmp, dataStyle);
+        writer << rec.addr;
+        copy(rec.address, sizeof(rec.address), writer.length());
+    }
+}
+
 }
@@ -10,13 +10,49 @@
 #include "PeddleTypes.h"
 #include "PeddleUtils.h"
 #include "StrWriter.h"
+#include "PeddleSymbols.h"
 
 namespace peddle {
 
+// Size of a buffer holding any instruction written by disassemble() (assuming
+// an indentation below 32 characters)
+static constexpr isize DASM_MAX_INSTR = 64;
+
+/* Compiled format string
+ *
+ * Format strings passed to disass() are parsed once and turned into a list of
+ * output operations. Literal text is stored inside the structure. Hence, the
+ * compiled format does not depend on the lifetime of the original string.
+ */
+struct DasmFormat {
+
+    static constexpr isize maxOps = 32;
+    static constexpr isize maxText = 128;
+
+    struct Op {
+
+        // Output operation ('p', 'a', 'x', 'y', 's', 'b', 'i', 'f', 'c', or 0 for text)
+        char kind;
+
+        // Minimum field width
+        u8 tab;
+
+        // Location of the literal text
+        u8 offset;
+        u8 length;
+    };
+
+    Op ops[maxOps];
+    isize count = 0;
+
+    char text[maxText];
+};
+
 class Disassembler {
 
     friend class Peddle;
     friend class Debugger;
+    friend class TraceFormatter;
 
     // Reference to the connected CPU
     class Peddle &cpu;
@@ -29,6 +65,84 @@ public:
     // Visual style for data dumps
     DasmStyle dataStyle;
 
+    // Labels substituted for address operands
+    SymbolTable symbols;
+
+private:
+
+    // Formatted bytes for a specific style
+    struct ByteTable {
+
+        // The style the table has been computed for
+        DasmStyle style = { };
+        char prefix[8] = { };
+
+        // Indicates whether all bytes fit into the table
+        bool valid = false;
+
+        // Indicates whether a word is formatted as two consecutive bytes
+        bool pairs = false;
+
+        char text[256][8];
+        u8 length[256];
+    };
+
+    // Output template for a single opcode (the operand is inserted in between)
+    struct Template {
+
+        char head[32];
+        char tail[4];
+        u8 headLen;
+        u8 tailLen;
+        u8 operand;
+
+        // Indicates whether the operand denotes an address
+        bool symbolic;
+    };
+
+    // Precomputed output for the current styles
+    ByteTable instrBytes;
+    ByteTable dataBytes;
+    Template templates[256];
+
+    // Cached output of a single instruction
+    struct CacheEntry {
+
+        u16 addr;
+
+        // Instruction bytes the text has been created for
+        u8 bytes[3];
+
+        // Instruction length
+        u8 length;
+
+        // Length of the text (0 marks an empty entry)
+        u8 textLen;
+
+        char text[60];
+    };
+
+    /* Disassembly cache
+     *
+     * The cache is direct-mapped and stores the formatted instruction for the
+     * most recently disassembled addresses. The cached text depends on the
+     * instruction bytes, the instruction style, and the symbol table. Each
+     * entry stores the bytes it has been created for, which are compared
+     * against readDasm() on every hit. Hence, memory modified behind the
+     * CPU's back never yields stale output, and the memory interface doesn't
+     * need to inform the cache about writes. Changing the style
+     * via the setters or updateTables() and modifying the symbol table empty
+     * the cache. While a style is modified directly, the cache is bypassed.
+     */
+    static constexpr isize cacheSize = 1024;
+    CacheEntry *cache = nullptr;
+
+    // Version of the symbol table the cached entries have been created with
+    mutable isize cachedSymbols = 0;
+
+    // Indicates whether the cache is enabled
+    bool cacheEnabled = false;
+
 
     //
     // Initializing
@@ -37,6 +151,9 @@ public:
 public:
 
     Disassembler(Peddle& ref);
+    ~Disassembler();
+
+    void reset();
 
 
     //
@@ -47,6 +164,50 @@ public:
     void setNumberFormat(DasmNumberFormat format) { setNumberFormat(format, format); }
     void setIndentation(int value);
 
+    // Recomputes the output tables (required if a style is modified directly)
+    void updateTables();
+
+private:
+
+    void updateTable(ByteTable &table, const DasmStyle &style);
+    bool matches(const ByteTable &table, const DasmStyle &style) const;
+
+
+    //
+    // Caching
+    //
+
+public:
+
+    // Turns the disassembly cache on or off
+    void enableCache();
+    void disableCache();
+    bool isCacheEnabled() const { return cacheEnabled; }
+
+    // Empties the cache
+    void flushCache() const;
+
+    // Drops the entries covering a modified memory location (optional, as
+    // hits are validated anyway)
+    void invalidate(u16 addr) {
+
+        if (!cache) return;
+
+        for (isize i = 0; i < 3; i++) {
+
+            auto &entry = cache[(addr - i) & (cacheSize - 1)];
+            if (entry.addr == u16(addr - i)) entry.textLen = 0;
+        }
+    }
+
+private:
+
+    // Returns the cache entry for an address, or nullptr if it can't be cached
+    const CacheEntry *lookup(u16 addr) const;
+
+    // Copies the text of a cache entry including the terminating zero
+    static void copyCached(char *dst, const CacheEntry &entry);
+
 
     //
     // Running the disassembler
@@ -54,19 +215,39 @@ public:
 
 public:
 
+    // Compiles a format string
+    static DasmFormat compile(const char *fmt);
+
     // Experimental
     isize disass(char *dst, const char *fmt, u16 addr) const;
     isize disass(char *dst, const char *fmt, const RecordedInstruction &instr) const;
+    isize disass(char *dst, const DasmFormat &fmt, const RecordedInstruction &instr) const;
     isize disass(char *dst, u16 addr) const;
     isize disass(char *dst, const RecordedInstruction &instr) const;
 
 private:
 
+    // Writes a record without a terminating zero and returns the end of the text
+    char *writeRecord(char *dst, const DasmFormat &fmt, const RecordedInstruction &instr) const;
+
+    // Returns an upper bound for the length of a record written in the current styles
+    isize maxLength(const DasmFormat &fmt) const;
+
+    // Writes a single instruction and returns the number of written characters
+    isize writeInstr(char *dst, u16 pc, u8 byte1, u8 byte2, u8 byte3) const;
+
+    // Writes a single byte in data style and returns the number of written characters
+    isize writeByte(char *dst, u8 value) const;
+
+    // Writes a word without a terminating zero and returns the number of written characters
+    isize writeWord(char *dst, const ByteTable &table, const DasmStyle &style, u16 value) const;
+
     isize disass8(u8 value, char *dst, isize tab) const;
     isize disass16(u16 value, char *dst, isize tab) const;
     isize disassB(u8 byte1, u8 byte2, u8 byte3, char *dst, isize tab) const;
     isize disassI(u16 addr, u8 byte1, u8 byte2, u8 byte3, char *dst, isize tab) const;
     isize disassF(u8 flags, char *dst, isize tab) const;
+    isize disassC(u64 cycle, char *dst, isize tab) const;
 
 public:
 
@@ -91,6 +272,32 @@ public:
     // Disassembles larger code sections
     void disassembleRange(std::ostream& os, u16 addr, isize count);
     void disassembleRange(std::ostream& os, std::pair<u16, u16> range, isize max = 255);
+
+    /* Disassembles a memory range into an array of records
+     *
+     * The range is read once via readDasm() and split into instructions in a
+     * single sequential pass, which makes chunk boundaries trivial. Afterwards,
+     * the records are formatted by multiple threads. If threads is 0, the
+     * number of hardware threads is used. Truncated strings are terminated.
+     * The function returns the number of written records, which never exceeds
+     * the range size.
+     */
+    isize disassembleRange(DasmRecord *dst, isize capacity,
+                           std::pair<u16, u16> range, isize threads = 0) const;
+
+    /* Disassembles the instructions around an address into an array of records
+     *
+     * The function writes the given number of instructions preceding the
+     * address, which are determined by the instruction-boundary index, followed
+     * by the instructions starting at the address. The array must be large
+     * enough to hold before + after records.
+     */
+    isize disassembleAround(DasmRecord *dst, u16 addr, isize before, isize after) const;
+
+private:
+
+    // Formats a slice of records (called by multiple threads)
+    void formatRecords(DasmRecord *dst, isize count) const;
 };
 
 }
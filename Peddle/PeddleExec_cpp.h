@@ -12,13 +12,13 @@
 
 // Atomic CPU tasks
 #define FETCH_OPCODE \
-if (likely(!rdyLine)) instr = read<C>(reg.pc++); else return;
+if (likely(!rdyLine)) instr = fetchOpcode<C>(reg.pc++); else return;
 #define FETCH_ADDR_LO \
-if (likely(!rdyLine)) reg.adl = read<C>(reg.pc++); else return;
+if (likely(!rdyLine)) reg.adl = fetchOperand<C>(reg.pc++); else return;
 #define FETCH_ADDR_HI \
-if (likely(!rdyLine)) reg.adh = read<C>(reg.pc++); else return;
+if (likely(!rdyLine)) reg.adh = fetchOperand<C>(reg.pc++); else return;
 #define FETCH_POINTER_ADDR \
-if (likely(!rdyLine)) reg.idl = read<C>(reg.pc++); else return;
+if (likely(!rdyLine)) reg.idl = fetchOperand<C>(reg.pc++); else return;
 #define FETCH_ADDR_LO_INDIRECT \
 if (likely(!rdyLine)) reg.adl = read<C>((u16)reg.idl++); else return;
 #define FETCH_ADDR_HI_INDIRECT \
@@ -27,15 +27,21 @@ if (likely(!rdyLine)) reg.adh = read<C>((u16)reg.idl++); else return;
 if (likely(!rdyLine)) readIdle<C>(reg.pc); else return;
 
 #define READ_RELATIVE \
-if (likely(!rdyLine)) reg.d = read<C>(reg.pc); else return;
+if (likely(!rdyLine)) reg.d = fetchOperand<C>(reg.pc); else return;
 #define READ_IMMEDIATE \
-if (likely(!rdyLine)) reg.d = read<C>(reg.pc++); else return;
+if (likely(!rdyLine)) reg.d = fetchOperand<C>(reg.pc++); else return;
 #define READ_FROM(x) \
 if (likely(!rdyLine)) reg.d = read<C>(x); else return;
 #define READ_FROM_ADDRESS \
 if (likely(!rdyLine)) reg.d = read<C>(HI_LO(reg.adh, reg.adl)); else return;
+#define READ_FROM_INDEXED_ADDRESS \
+if (likely(!rdyLine)) reg.d = readIndexed<C>(HI_LO(reg.adh, reg.adl)); else return;
+#define DUMMY_READ_FROM_ADDRESS \
+if (likely(!rdyLine)) reg.d = readDummy<C>(HI_LO(reg.adh, reg.adl)); else return;
 #define READ_FROM_ZERO_PAGE \
 if (likely(!rdyLine)) reg.d = readZeroPage<C>(reg.adl); else return;
+#define DUMMY_READ_FROM_ZERO_PAGE \
+if (likely(!rdyLine)) reg.d = readDummy<C>(u16(reg.adl)); else return;
 #define READ_FROM_ADDRESS_INDIRECT \
 if (likely(!rdyLine)) reg.d = readZeroPage<C>(reg.dl); else return;
 
@@ -279,6 +285,19 @@ Peddle::reset()
     setI(1);
 
     debugger.reset();
+    disassembler.reset();
+    profiler.reset();
+    callGraph.reset();
+    sampler.reset();
+    coverage.reset();
+    journal.reset();
+    publisher.reset();
+    commands.reset();
+    xrefs.reset();
+    boundaries.reset();
+    stats.reset();
+    fusion.reset();
+    traps.reset();
 }
 
 void
@@ -377,7 +396,7 @@ Peddle::execute()
             
         case irq_5:
             
-            write<C>(0x100+(reg.sp--), getPWithClearedB());
+            writeStack<C>(reg.sp--, getPWithClearedB());
             CONTINUE
             
         case irq_6:
@@ -415,7 +434,7 @@ Peddle::execute()
             
         case nmi_5:
             
-            write<C>(0x100+(reg.sp--), getPWithClearedB());
+            writeStack<C>(reg.sp--, getPWithClearedB());
             CONTINUE
             
         case nmi_6:
@@ -496,13 +515,13 @@ Peddle::execute()
         case ISC_zpg_x_2: case RLA_zpg_x_2: case RRA_zpg_x_2: case SLO_zpg_x_2:
         case SRE_zpg_x_2: case STA_zpg_x_2: case STY_zpg_x_2:
             
-            READ_FROM_ZERO_PAGE
+            DUMMY_READ_FROM_ZERO_PAGE
             ADD_INDEX_X
             CONTINUE
 
         case LDX_zpg_y_2: case LAX_zpg_y_2: case STX_zpg_y_2: case SAX_zpg_y_2:
             
-            READ_FROM_ZERO_PAGE
+            DUMMY_READ_FROM_ZERO_PAGE
             ADD_INDEX_Y
             CONTINUE
 
@@ -600,7 +619,7 @@ Peddle::execute()
         case LSR_abs_y_3: case STA_abs_y_3: case DCP_abs_y_3: case ISC_abs_y_3:
         case RLA_abs_y_3: case RRA_abs_y_3: case SLO_abs_y_3: case SRE_abs_y_3:
             
-            READ_FROM_ADDRESS
+            DUMMY_READ_FROM_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) { FIX_ADDR_HI }
             CONTINUE
             
@@ -701,7 +720,7 @@ Peddle::execute()
         case LSR_ind_y_4: case STA_ind_y_4: case DCP_ind_y_4: case ISC_ind_y_4:
         case RLA_ind_y_4: case RRA_ind_y_4: case SLO_ind_y_4: case SRE_ind_y_4:
             
-            READ_FROM_ADDRESS
+            DUMMY_READ_FROM_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) { FIX_ADDR_HI }
             CONTINUE
             
@@ -768,7 +787,7 @@ Peddle::execute()
         case ADC_abs_y_3:
         case ADC_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -816,7 +835,7 @@ Peddle::execute()
         case AND_abs_y_3:
         case AND_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -1222,7 +1241,7 @@ Peddle::execute()
         case CMP_abs_y_3:
         case CMP_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -1400,7 +1419,7 @@ Peddle::execute()
         case EOR_abs_y_3:
         case EOR_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -1597,7 +1616,7 @@ Peddle::execute()
         case LDA_abs_y_3:
         case LDA_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -1644,7 +1663,7 @@ Peddle::execute()
         case LDX_abs_y_3:
         case LDX_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -1690,7 +1709,7 @@ Peddle::execute()
         case LDY_abs_x_3:
         case LDY_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -1831,7 +1850,7 @@ Peddle::execute()
         case ORA_abs_y_3:
         case ORA_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -2109,7 +2128,7 @@ Peddle::execute()
         case SBC_abs_y_3:
         case SBC_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -2548,7 +2567,7 @@ Peddle::execute()
             
         case LAS_abs_y_3:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -2591,7 +2610,7 @@ Peddle::execute()
         case LAX_abs_y_3:
         case LAX_ind_y_4:
             
-            READ_FROM_ADDRESS
+            READ_FROM_INDEXED_ADDRESS
             if (PAGE_BOUNDARY_CROSSED) {
                 FIX_ADDR_HI
                 CONTINUE
@@ -3070,6 +3089,16 @@ Peddle::executeInstruction()
 template <CPURevision C> void
 Peddle::executeInstruction()
 {
+    // The fast paths check traps themselves
+    if (!(flags & ~CPU_CHECK_TRAP) && next == fetch) {
+
+        // Run a copy or fill loop natively if possible
+        if (loops.enabled && loops.execute(reg.pc, INT64_MAX)) return;
+
+        // Execute a fused instruction pair if possible
+        if (fusion.enabled && executeFused<C>()) return;
+    }
+
     // Execute a singe cycle
     execute<C>();
 
@@ -3095,7 +3124,26 @@ Peddle::executeInstruction(int count)
 template <CPURevision C> void
 Peddle::executeInstruction(int count)
 {
-    for (int j = 0; j < count; j++) { executeInstruction<C>(); }
+    while (count > 0) {
+
+        // The fast paths check traps themselves
+        if (!(flags & ~CPU_CHECK_TRAP) && next == fetch) {
+
+            // Run a copy or fill loop natively if it fits into the remaining count
+            if (loops.enabled) {
+                if (auto n = loops.execute(reg.pc, count)) { count -= int(n); continue; }
+            }
+
+            // Execute a fused instruction pair if both instructions are requested
+            if (fusion.enabled && count > 1) {
+                if (auto n = executeFused<C>()) { count -= n; continue; }
+            }
+        }
+
+        execute<C>();
+        finishInstruction<C>();
+        count--;
+    }
 }
 
 void
@@ -3124,12 +3172,67 @@ Peddle::done() {
 
     if (flags) {
 
+        if (flags & CPU_CHECK_TRIGGER) {
+
+            debugger.triggers.eval();
+        }
+
         if (flags & CPU_LOG_INSTRUCTION) {
 
             debugger.logInstruction();
             instructionLogged();
         }
 
+        if (flags & CPU_PROFILE) {
+
+            if (next == irq_7 || next == nmi_7) {
+                profiler.recordInterrupt(clock);
+            } else {
+                profiler.recordInstruction(reg.pc0, clock);
+            }
+        }
+
+        if (flags & CPU_PROFILE_CALLS) {
+
+            callGraph.recordInstruction(next);
+        }
+
+        if (flags & CPU_SAMPLE) {
+
+            sampler.recordInstruction(next, clock);
+        }
+
+        if (flags & CPU_COLLECT_STATS) {
+
+            stats.recordInstruction(next, PAGE_BOUNDARY_CROSSED);
+        }
+
+        if (flags & CPU_TRACK_XREFS) {
+
+            xrefs.recordInstruction(next, reg.pc0, reg.pc);
+        }
+
+        if (flags & CPU_PUBLISH_STATE) {
+
+            publisher.recordInstruction(clock);
+        }
+
+        if (flags & CPU_PROCESS_COMMANDS) {
+
+            commands.recordInstruction();
+        }
+
+        if ((flags & CPU_CHECK_TRAP) && traps.isSet(reg.pc)) {
+
+            reg.pc = trapReached(reg.pc, traps.id(reg.pc));
+        }
+
+        // Capture the registers after commands and trap handlers have run
+        if (flags & CPU_JOURNAL) {
+
+            journal.recordInstruction();
+        }
+
         if ((flags & CPU_CHECK_BP) && debugger.breakpointMatches(reg.pc)) {
 
             breakpointReached(reg.pc);
@@ -0,0 +1,178 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace peddle {
+
+Fusion::~Fusion()
+{
+    delete [] slots;
+}
+
+void
+Fusion::reset()
+{
+    flush();
+}
+
+void
+Fusion::enable()
+{
+    if (!slots) slots = new Slot[slotCount]();
+    flush();
+    enabled = true;
+}
+
+void
+Fusion::disable()
+{
+    enabled = false;
+}
+
+bool
+Fusion::isSuspended() const
+{
+    return cpu.flags & ~CPU_CHECK_TRAP;
+}
+
+bool
+Fusion::isFusible(u8 opcode)
+{
+    switch (opcode) {
+
+        // Implied and accumulator mode
+        case 0x18: case 0x38: case 0xB8: case 0xD8: case 0xF8: case 0xEA:
+        case 0xAA: case 0xA8: case 0x8A: case 0x98: case 0xBA: case 0x9A:
+        case 0xE8: case 0xC8: case 0xCA: case 0x88:
+        case 0x0A: case 0x4A: case 0x2A: case 0x6A:
+
+        // Loads
+        case 0xA9: case 0xA5: case 0xB5: case 0xAD: case 0xBD: case 0xB9: case 0xB1:
+        case 0xA2: case 0xA6: case 0xB6: case 0xAE: case 0xBE:
+        case 0xA0: case 0xA4: case 0xB4: case 0xAC: case 0xBC:
+
+        // Stores
+        case 0x85: case 0x95: case 0x8D: case 0x9D: case 0x99: case 0x91:
+        case 0x86: case 0x96: case 0x8E:
+        case 0x84: case 0x94: case 0x8C:
+
+        // Arithmetic and logic operations
+        case 0x69: case 0x65: case 0x75: case 0x6D: case 0x7D: case 0x79: case 0x71:
+        case 0xE9: case 0xE5: case 0xF5: case 0xED: case 0xFD: case 0xF9: case 0xF1:
+        case 0x29: case 0x25: case 0x35: case 0x2D: case 0x3D: case 0x39: case 0x31:
+        case 0x09: case 0x05: case 0x15: case 0x0D: case 0x1D: case 0x19: case 0x11:
+        case 0x49: case 0x45: case 0x55: case 0x4D: case 0x5D: case 0x59: case 0x51:
+        case 0x24: case 0x2C:
+
+        // Comparisons
+        case 0xC9: case 0xC5: case 0xD5: case 0xCD: case 0xDD: case 0xD9: case 0xD1:
+        case 0xE0: case 0xE4: case 0xEC:
+        case 0xC0: case 0xC4: case 0xCC:
+
+        // Branches and jumps
+        case 0x90: case 0xB0: case 0xF0: case 0x30:
+        case 0xD0: case 0x10: case 0x50: case 0x70:
+        case 0x4C:
+
+            return true;
+
+        default:
+
+            return false;
+    }
+}
+
+void
+Fusion::fuse(u8 first, u8 second)
+{
+    if (!isFusible(first) || !isFusible(second)) {
+        throw std::runtime_error("instruction pair cannot be fused");
+    }
+
+    auto nr = first << 8 | second;
+    if (!isFused(first, second)) fused++;
+    pairs[nr >> 6] |= u64(1) << (nr & 63);
+    flush();
+}
+
+isize
+Fusion::select(isize max)
+{
+    auto &stats = cpu.stats;
+    if (!stats.isTrackingPairs()) throw std::runtime_error("no pair profile available");
+
+    // Collect all candidates
+    std::vector<std::pair<u64, u16>> candidates;
+    for (isize i = 0; i < 65536; i++) {
+
+        auto first = u8(i >> 8), second = u8(i);
+        auto count = stats.pairCount(first, second);
+        if (count && isFusible(first) && isFusible(second)) candidates.push_back({ count, u16(i) });
+    }
+
+    // Keep the most frequent ones
+    auto n = std::min(isize(candidates.size()), std::max(max, isize(0)));
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(), [](auto &a, auto &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    clear();
+    for (isize i = 0; i < n; i++) fuse(u8(candidates[i].second >> 8), u8(candidates[i].second));
+
+    return n;
+}
+
+void
+Fusion::clear()
+{
+    memset(pairs, 0, sizeof(pairs));
+    fused = 0;
+    flush();
+}
+
+void
+Fusion::dump(std::ostream &os) const
+{
+    auto &stats = cpu.stats;
+
+    for (isize i = 0; i < 65536; i++) {
+
+        auto first = u8(i >> 8), second = u8(i);
+        if (!isFused(first, second)) continue;
+
+        char line[64];
+        snprintf(line, sizeof(line), "%02X %02X  %-4s %-4s %12llu\n",
+                 first, second, cpu.mnemonic[first], cpu.mnemonic[second],
+                 (unsigned long long)stats.pairCount(first, second));
+        os << line;
+    }
+}
+
+void
+Fusion::recognize(Slot &slot, u16 addr)
+{
+    slot.tag = 0x10000 | u32(addr);
+    slot.first = cpu.readDasm(addr);
+    slot.length = u8(cpu.getLengthOfInstruction(slot.first));
+    slot.second = cpu.readDasm(u16(addr + slot.length));
+    slot.fused = isFused(slot.first, slot.second);
+}
+
+void
+Fusion::flush()
+{
+    if (slots) memset(slots, 0, slotCount * sizeof(Slot));
+}
+
+}
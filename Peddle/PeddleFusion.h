@@ -0,0 +1,163 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <ostream>
+
+namespace peddle {
+
+/* Instruction fusion
+ *
+ * In instruction mode (executeInstruction()), the CPU usually runs through
+ * the microinstructions of an instruction one cycle at a time. If fusion is
+ * enabled, frequently executed pairs of instructions are recognized when the
+ * first instruction is about to be fetched and both are executed in a single
+ * call, each by a straight-line handler. The handlers perform the same memory
+ * accesses in the same order as the microinstructions, including dummy and
+ * idle accesses, poll the interrupt lines at the same points, and leave the
+ * registers in the same state. Hence, the host observes the same bus traffic
+ * and the same number of cycles. However, a call to executeInstruction() may
+ * now complete two instructions. executeInstruction(count) still completes
+ * exactly count instructions, because it only fuses a pair if at least two
+ * instructions remain.
+ *
+ * The set of fused pairs is not fixed. It is selected from the pair profile
+ * collected by the statistics component, or configured manually. Only pairs
+ * of instructions with a straight-line handler can be fused (see
+ * isFusible()).
+ *
+ * Pairs are recognized with the help of a small cache that maps the address
+ * of the first instruction to the expected opcodes. The cache is filled with
+ * readDasm() and never needs to be invalidated, because the fetched opcodes
+ * are compared with the expected ones: A mismatching opcode is executed
+ * regularly and drops the cache entry. The second instruction is executed
+ * only if the first one does not branch, no interrupt is pending, the RDY
+ * line is up, and no state flags have been set.
+ *
+ * Fusion is only applied if all state flags except CPU_CHECK_TRAP are
+ * cleared. Hence, every component hooking into the memory interface or into
+ * done() suspends it while enabled. Besides the debugging and tracing
+ * features (breakpoints, watchpoints, logging, triggers, the journal,
+ * coverage, cross-references, the boundary index), this includes the
+ * components that don't need to observe the bus: the profiler, the call
+ * graph, the sampler, the execution statistics, the state publisher, and
+ * the command queue. isSuspended() tells whether this is the case. Traps are
+ * checked by the handlers: A pair never starts at a trapped address, and
+ * each handler checks the address of the next instruction like done() does.
+ */
+class Fusion {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // A recognized pair
+    struct Slot {
+
+        // Address of the first instruction (bit 16 is set if the slot is used)
+        u32 tag;
+
+        // Expected opcodes
+        u8 first;
+        u8 second;
+
+        // Length of the first instruction
+        u8 length;
+
+        // Indicates whether the pair is fused
+        bool fused;
+    };
+
+    // Recognized pairs (direct-mapped by address)
+    static constexpr isize slotCount = 1024;
+    Slot *slots = nullptr;
+
+    // Fused pairs (one bit per pair, indexed by first << 8 | second)
+    u64 pairs[1024] = { };
+
+    // Number of fused pairs
+    isize fused = 0;
+
+    // Indicates whether fusion is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Fusion(Peddle& ref) : cpu(ref) { }
+    ~Fusion();
+
+    void reset();
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns fusion on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Checks whether a state flag prevents pairs from being fused
+    bool isSuspended() const;
+
+    // Checks whether an instruction has a straight-line handler
+    static bool isFusible(u8 opcode);
+
+    // Adds a single pair
+    void fuse(u8 first, u8 second);
+
+    // Replaces the fused pairs by the most frequent fusible pairs of the profile
+    isize select(isize max = 32);
+
+    // Removes all pairs
+    void clear();
+
+    // Checks whether a pair is fused
+    bool isFused(u8 first, u8 second) const {
+
+        auto nr = first << 8 | second;
+        return pairs[nr >> 6] >> (nr & 63) & 1;
+    }
+
+    // Returns the number of fused pairs
+    isize count() const { return fused; }
+
+    // Prints all fused pairs
+    void dump(std::ostream &os) const;
+
+private:
+
+    // Returns the slot for an address, recognizing the pair if necessary
+    const Slot &lookup(u16 addr) {
+
+        auto &slot = slots[addr & (slotCount - 1)];
+        if (slot.tag != (0x10000 | u32(addr))) recognize(slot, addr);
+        return slot;
+    }
+
+    // Fills a slot
+    void recognize(Slot &slot, u16 addr);
+
+    // Drops the slot for an address
+    void forget(u16 addr) { slots[addr & (slotCount - 1)].tag = 0; }
+
+    // Drops all slots
+    void flush();
+};
+
+}
@@ -0,0 +1,250 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+/* Straight-line handlers
+ *
+ * Each handler performs all cycles of an instruction at once. The addressing
+ * modes mirror the shared microinstructions in PeddleExec_cpp.h, including
+ * dummy accesses and the intermediate register values.
+ */
+#define FAST_IMMEDIATE      reg.d = fetchOperand<C>(reg.pc++);
+#define FAST_ZERO_PAGE      reg.adl = fetchOperand<C>(reg.pc++);
+#define FAST_ZERO_PAGE_X    FAST_ZERO_PAGE reg.d = readZeroPage<C>(reg.adl); ADD_INDEX_X
+#define FAST_ZERO_PAGE_Y    FAST_ZERO_PAGE reg.d = readZeroPage<C>(reg.adl); ADD_INDEX_Y
+#define FAST_ABSOLUTE       reg.adl = fetchOperand<C>(reg.pc++); reg.adh = fetchOperand<C>(reg.pc++);
+#define FAST_ABSOLUTE_X     FAST_ABSOLUTE ADD_INDEX_X
+#define FAST_ABSOLUTE_Y     FAST_ABSOLUTE ADD_INDEX_Y
+#define FAST_INDIRECT_Y     reg.idl = fetchOperand<C>(reg.pc++); \
+reg.adl = read<C>((u16)reg.idl++); reg.adh = read<C>((u16)reg.idl++); ADD_INDEX_Y
+
+#define FAST_READ_ZERO_PAGE reg.d = readZeroPage<C>(reg.adl);
+#define FAST_READ           reg.d = read<C>(HI_LO(reg.adh, reg.adl));
+#define FAST_READ_INDEXED   FAST_READ if (PAGE_BOUNDARY_CROSSED) { FIX_ADDR_HI FAST_READ }
+#define FAST_PREPARE_WRITE  FAST_READ if (PAGE_BOUNDARY_CROSSED) { FIX_ADDR_HI }
+
+// Instructions reading an operand
+#define FAST_IMM(op)        FAST_IMMEDIATE op; POLL_INT break;
+#define FAST_ZPG(op)        FAST_ZERO_PAGE FAST_READ_ZERO_PAGE op; POLL_INT break;
+#define FAST_ZPG_X(op)      FAST_ZERO_PAGE_X FAST_READ_ZERO_PAGE op; POLL_INT break;
+#define FAST_ZPG_Y(op)      FAST_ZERO_PAGE_Y FAST_READ_ZERO_PAGE op; POLL_INT break;
+#define FAST_ABS(op)        FAST_ABSOLUTE FAST_READ op; POLL_INT break;
+#define FAST_ABS_X(op)      FAST_ABSOLUTE_X FAST_READ_INDEXED op; POLL_INT break;
+#define FAST_ABS_Y(op)      FAST_ABSOLUTE_Y FAST_READ_INDEXED op; POLL_INT break;
+#define FAST_IND_Y(op)      FAST_INDIRECT_Y FAST_READ_INDEXED op; POLL_INT break;
+
+// Instructions writing a register
+#define FAST_STORE_ZPG(r)   FAST_ZERO_PAGE reg.d = r; WRITE_TO_ZERO_PAGE POLL_INT break;
+#define FAST_STORE_ZPG_X(r) FAST_ZERO_PAGE_X reg.d = r; WRITE_TO_ZERO_PAGE POLL_INT break;
+#define FAST_STORE_ZPG_Y(r) FAST_ZERO_PAGE_Y reg.d = r; WRITE_TO_ZERO_PAGE POLL_INT break;
+#define FAST_STORE_ABS(r)   FAST_ABSOLUTE reg.d = r; WRITE_TO_ADDRESS POLL_INT break;
+#define FAST_STORE_ABS_X(r) FAST_ABSOLUTE_X FAST_PREPARE_WRITE reg.d = r; WRITE_TO_ADDRESS POLL_INT break;
+#define FAST_STORE_ABS_Y(r) FAST_ABSOLUTE_Y FAST_PREPARE_WRITE reg.d = r; WRITE_TO_ADDRESS POLL_INT break;
+#define FAST_STORE_IND_Y(r) FAST_INDIRECT_Y FAST_PREPARE_WRITE reg.d = r; WRITE_TO_ADDRESS POLL_INT break;
+
+// Instructions without an operand
+#define FAST_IMPLIED(op)    readIdle<C>(reg.pc); op; POLL_INT break;
+
+// Branches
+#define FAST_BRANCH(cond) \
+FAST_IMMEDIATE POLL_INT \
+if (cond) { \
+readIdle<C>(reg.pc); \
+u8 pc_hi = HI_BYTE(reg.pc); \
+reg.pc += (i8)reg.d; \
+if (unlikely(pc_hi != HI_BYTE(reg.pc))) { \
+readIdle<C>((reg.d & 0x80) ? reg.pc + 0x100 : reg.pc - 0x100); \
+POLL_INT_AGAIN } } \
+break;
+
+#define DO_BIT setN(reg.d & 128); setV(reg.d & 64); setZ((reg.d & reg.a) == 0);
+
+template <CPURevision C> int
+Peddle::executeFused()
+{
+    // Leave interrupts and the RDY line to the microinstructions
+    if (doNmi || doIrq || rdyLine) return 0;
+
+    // Leave trapped addresses to the regular path
+    if ((flags & CPU_CHECK_TRAP) && traps.isSet(reg.pc)) return 0;
+
+    // Check whether the next two instructions form a fused pair
+    auto &slot = fusion.lookup(reg.pc);
+    if (!slot.fused) return 0;
+
+    u8 first = slot.first, second = slot.second;
+    u16 addr = reg.pc, follow = u16(reg.pc + slot.length);
+
+    // Execute the first instruction
+    u8 opcode = fetchOpcode<C>(reg.pc++);
+    if (unlikely(opcode != first)) fusion.forget(addr);
+    executeFast<C>(opcode);
+
+    // Stop if the pair has been broken up
+    if (opcode != first || reg.pc != follow) return 1;
+    if (doNmi || doIrq || rdyLine || (flags & ~CPU_CHECK_TRAP)) return 1;
+
+    // Execute the second instruction
+    opcode = fetchOpcode<C>(reg.pc++);
+    if (unlikely(opcode != second)) fusion.forget(addr);
+    executeFast<C>(opcode);
+
+    return 2;
+}
+
+template <CPURevision C> void
+Peddle::executeFast(u8 opcode)
+{
+    switch (opcode) {
+
+        case 0x18: FAST_IMPLIED(setC(0))                // CLC
+        case 0x38: FAST_IMPLIED(setC(1))                // SEC
+        case 0xB8: FAST_IMPLIED(setV(0))                // CLV
+        case 0xD8: FAST_IMPLIED(setD(0))                // CLD
+        case 0xF8: FAST_IMPLIED(setD(1))                // SED
+        case 0xEA: FAST_IMPLIED()                       // NOP
+        case 0xAA: FAST_IMPLIED(loadX(reg.a))           // TAX
+        case 0xA8: FAST_IMPLIED(loadY(reg.a))           // TAY
+        case 0x8A: FAST_IMPLIED(loadA(reg.x))           // TXA
+        case 0x98: FAST_IMPLIED(loadA(reg.y))           // TYA
+        case 0xBA: FAST_IMPLIED(loadX(reg.sp))          // TSX
+        case 0x9A: FAST_IMPLIED(reg.sp = reg.x)         // TXS
+        case 0xE8: FAST_IMPLIED(loadX(reg.x + 1))       // INX
+        case 0xC8: FAST_IMPLIED(loadY(reg.y + 1))       // INY
+        case 0xCA: FAST_IMPLIED(loadX(reg.x - 1))       // DEX
+        case 0x88: FAST_IMPLIED(loadY(reg.y - 1))       // DEY
+        case 0x0A: FAST_IMPLIED(DO_ASL_ACC)             // ASL A
+        case 0x4A: FAST_IMPLIED(setC(reg.a & 1); loadA(reg.a >> 1)) // LSR A
+        case 0x2A: FAST_IMPLIED(DO_ROL_ACC)             // ROL A
+        case 0x6A: FAST_IMPLIED(DO_ROR_ACC)             // ROR A
+
+        case 0xA9: FAST_IMM(loadA(reg.d))               // LDA
+        case 0xA5: FAST_ZPG(loadA(reg.d))
+        case 0xB5: FAST_ZPG_X(loadA(reg.d))
+        case 0xAD: FAST_ABS(loadA(reg.d))
+        case 0xBD: FAST_ABS_X(loadA(reg.d))
+        case 0xB9: FAST_ABS_Y(loadA(reg.d))
+        case 0xB1: FAST_IND_Y(loadA(reg.d))
+
+        case 0xA2: FAST_IMM(loadX(reg.d))               // LDX
+        case 0xA6: FAST_ZPG(loadX(reg.d))
+        case 0xB6: FAST_ZPG_Y(loadX(reg.d))
+        case 0xAE: FAST_ABS(loadX(reg.d))
+        case 0xBE: FAST_ABS_Y(loadX(reg.d))
+
+        case 0xA0: FAST_IMM(loadY(reg.d))               // LDY
+        case 0xA4: FAST_ZPG(loadY(reg.d))
+        case 0xB4: FAST_ZPG_X(loadY(reg.d))
+        case 0xAC: FAST_ABS(loadY(reg.d))
+        case 0xBC: FAST_ABS_X(loadY(reg.d))
+
+        case 0x85: FAST_STORE_ZPG(reg.a)                // STA
+        case 0x95: FAST_STORE_ZPG_X(reg.a)
+        case 0x8D: FAST_STORE_ABS(reg.a)
+        case 0x9D: FAST_STORE_ABS_X(reg.a)
+        case 0x99: FAST_STORE_ABS_Y(reg.a)
+        case 0x91: FAST_STORE_IND_Y(reg.a)
+
+        case 0x86: FAST_STORE_ZPG(reg.x)                // STX
+        case 0x96: FAST_STORE_ZPG_Y(reg.x)
+        case 0x8E: FAST_STORE_ABS(reg.x)
+
+        case 0x84: FAST_STORE_ZPG(reg.y)                // STY
+        case 0x94: FAST_STORE_ZPG_X(reg.y)
+        case 0x8C: FAST_STORE_ABS(reg.y)
+
+        case 0x69: FAST_IMM(adc(reg.d))                 // ADC
+        case 0x65: FAST_ZPG(adc(reg.d))
+        case 0x75: FAST_ZPG_X(adc(reg.d))
+        case 0x6D: FAST_ABS(adc(reg.d))
+        case 0x7D: FAST_ABS_X(adc(reg.d))
+        case 0x79: FAST_ABS_Y(adc(reg.d))
+        case 0x71: FAST_IND_Y(adc(reg.d))
+
+        case 0xE9: FAST_IMM(sbc(reg.d))                 // SBC
+        case 0xE5: FAST_ZPG(sbc(reg.d))
+        case 0xF5: FAST_ZPG_X(sbc(reg.d))
+        case 0xED: FAST_ABS(sbc(reg.d))
+        case 0xFD: FAST_ABS_X(sbc(reg.d))
+        case 0xF9: FAST_ABS_Y(sbc(reg.d))
+        case 0xF1: FAST_IND_Y(sbc(reg.d))
+
+        case 0x29: FAST_IMM(loadA(reg.a & reg.d))      // AND
+        case 0x25: FAST_ZPG(loadA(reg.a & reg.d))
+        case 0x35: FAST_ZPG_X(loadA(reg.a & reg.d))
+        case 0x2D: FAST_ABS(loadA(reg.a & reg.d))
+        case 0x3D: FAST_ABS_X(loadA(reg.a & reg.d))
+        case 0x39: FAST_ABS_Y(loadA(reg.a & reg.d))
+        case 0x31: FAST_IND_Y(loadA(reg.a & reg.d))
+
+        case 0x09: FAST_IMM(loadA(reg.a | reg.d))      // ORA
+        case 0x05: FAST_ZPG(loadA(reg.a | reg.d))
+        case 0x15: FAST_ZPG_X(loadA(reg.a | reg.d))
+        case 0x0D: FAST_ABS(loadA(reg.a | reg.d))
+        case 0x1D: FAST_ABS_X(loadA(reg.a | reg.d))
+        case 0x19: FAST_ABS_Y(loadA(reg.a | reg.d))
+        case 0x11: FAST_IND_Y(loadA(reg.a | reg.d))
+
+        case 0x49: FAST_IMM(DO_EOR)                     // EOR
+        case 0x45: FAST_ZPG(DO_EOR)
+        case 0x55: FAST_ZPG_X(DO_EOR)
+        case 0x4D: FAST_ABS(DO_EOR)
+        case 0x5D: FAST_ABS_X(DO_EOR)
+        case 0x59: FAST_ABS_Y(DO_EOR)
+        case 0x51: FAST_IND_Y(DO_EOR)
+
+        case 0x24: FAST_ZPG(DO_BIT)                     // BIT
+        case 0x2C: FAST_ABS(DO_BIT)
+
+        case 0xC9: FAST_IMM(cmp(reg.a, reg.d))          // CMP
+        case 0xC5: FAST_ZPG(cmp(reg.a, reg.d))
+        case 0xD5: FAST_ZPG_X(cmp(reg.a, reg.d))
+        case 0xCD: FAST_ABS(cmp(reg.a, reg.d))
+        case 0xDD: FAST_ABS_X(cmp(reg.a, reg.d))
+        case 0xD9: FAST_ABS_Y(cmp(reg.a, reg.d))
+        case 0xD1: FAST_IND_Y(cmp(reg.a, reg.d))
+
+        case 0xE0: FAST_IMM(cmp(reg.x, reg.d))          // CPX
+        case 0xE4: FAST_ZPG(cmp(reg.x, reg.d))
+        case 0xEC: FAST_ABS(cmp(reg.x, reg.d))
+
+        case 0xC0: FAST_IMM(cmp(reg.y, reg.d))          // CPY
+        case 0xC4: FAST_ZPG(cmp(reg.y, reg.d))
+        case 0xCC: FAST_ABS(cmp(reg.y, reg.d))
+
+        case 0x90: FAST_BRANCH(!getC())                 // BCC
+        case 0xB0: FAST_BRANCH(getC())                  // BCS
+        case 0xF0: FAST_BRANCH(getZ())                  // BEQ
+        case 0x30: FAST_BRANCH(getN())                  // BMI
+        case 0xD0: FAST_BRANCH(!getZ())                 // BNE
+        case 0x10: FAST_BRANCH(!getN())                 // BPL
+        case 0x50: FAST_BRANCH(!getV())                 // BVC
+        case 0x70: FAST_BRANCH(getV())                  // BVS
+
+        case 0x4C:                                      // JMP
+
+            FAST_ABSOLUTE
+            reg.pc = LO_HI(reg.adl, reg.adh);
+            POLL_INT
+            break;
+
+        default:
+
+            // Run all other instructions through the microinstructions
+            next = actionFunc[opcode];
+            finishInstruction<C>();
+            return;
+    }
+
+    // Check the next instruction for a trap like done() does
+    if ((flags & CPU_CHECK_TRAP) && traps.isSet(reg.pc)) {
+
+        reg.pc = trapReached(reg.pc, traps.id(reg.pc));
+    }
+
+    reg.pc0 = reg.pc;
+    next = fetch;
+}
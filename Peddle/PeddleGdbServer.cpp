@@ -0,0 +1,521 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include "PeddleGdbServer.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Don't raise SIGPIPE if the client has disconnected
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+#endif
+
+namespace peddle {
+
+static std::string
+hex8(u8 value)
+{
+    static const char digits[] = "0123456789abcdef";
+    return { digits[value >> 4], digits[value & 0xF] };
+}
+
+static u64
+parseHex(const std::string &str, size_t &pos)
+{
+    u64 result = 0;
+
+    for (; pos < str.size() && isxdigit((unsigned char)str[pos]); pos++) {
+
+        char c = str[pos];
+        result = result << 4 | u64(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+    }
+    return result;
+}
+
+static u8
+checksum(const std::string &str)
+{
+    u8 result = 0;
+    for (auto c : str) result = u8(result + u8(c));
+    return result;
+}
+
+GdbServer::~GdbServer()
+{
+    stop();
+}
+
+
+//
+// Controlling
+//
+
+#ifdef _WIN32
+
+void
+GdbServer::listen(u16 port)
+{
+    throw std::runtime_error("the GDB server is not supported on this platform");
+}
+
+void
+GdbServer::listen(const std::string &path)
+{
+    throw std::runtime_error("the GDB server is not supported on this platform");
+}
+
+void
+GdbServer::stop()
+{
+
+}
+
+#else
+
+void
+GdbServer::listen(u16 port)
+{
+    if (listenFd >= 0) throw std::runtime_error("the GDB server is already running");
+
+    sockaddr_in addr = { };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) throw std::runtime_error(strerror(errno));
+
+    int on = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    if (bind(listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(listenFd, 1) < 0) {
+
+        auto error = std::string(strerror(errno));
+        close(listenFd);
+        listenFd = -1;
+        throw std::runtime_error(error);
+    }
+
+    start();
+}
+
+void
+GdbServer::listen(const std::string &path)
+{
+    if (listenFd >= 0) throw std::runtime_error("the GDB server is already running");
+
+    sockaddr_un addr = { };
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("socket path is too long");
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) throw std::runtime_error(strerror(errno));
+
+    unlink(path.c_str());
+
+    if (bind(listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(listenFd, 1) < 0) {
+
+        auto error = std::string(strerror(errno));
+        close(listenFd);
+        listenFd = -1;
+        throw std::runtime_error(error);
+    }
+
+    socketPath = path;
+    start();
+}
+
+void
+GdbServer::stop()
+{
+    if (listenFd < 0) return;
+
+    quit = true;
+    if (thread.joinable()) thread.join();
+
+    close(listenFd);
+    listenFd = -1;
+
+    if (!socketPath.empty()) {
+
+        unlink(socketPath.c_str());
+        socketPath.clear();
+    }
+
+    halted = false;
+}
+
+#endif
+
+
+//
+// Interfacing with the emulation thread
+//
+
+void
+GdbServer::process()
+{
+    Command cmd;
+
+    while (commands.pop(cmd)) {
+
+        switch (cmd.type) {
+
+            case GDB_ATTACH:
+
+                halted = true;
+                break;
+
+            case GDB_DETACH:
+
+                halted = false;
+                break;
+
+            case GDB_INTERRUPT:
+
+                if (!halted) {
+
+                    halted = true;
+                    reply("S02");
+                }
+                break;
+
+            case GDB_PACKET:
+            {
+                std::string result;
+                if (execute(cmd.packet, result)) reply(std::move(result));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+void
+GdbServer::stopped()
+{
+    if (attached && !halted) {
+
+        halted = true;
+        reply("S05");
+    }
+}
+
+bool
+GdbServer::execute(const std::string &packet, std::string &result)
+{
+    auto &reg = cpu.reg;
+    size_t pos = 1;
+
+    switch (packet.empty() ? 0 : packet[0]) {
+
+        case '?':
+
+            result = "S05";
+            return true;
+
+        case 'g':
+
+            result =
+            hex8(reg.a) + hex8(reg.x) + hex8(reg.y) + hex8(cpu.getP()) +
+            hex8(reg.sp) + hex8(LO_BYTE(reg.pc)) + hex8(HI_BYTE(reg.pc));
+            return true;
+
+        case 'G':
+        {
+            if (packet.size() < 15) { result = "E01"; return true; }
+
+            u8 values[7];
+            for (isize i = 0; i < 7; i++) {
+
+                std::string digits = packet.substr(1 + 2 * i, 2);
+                size_t q = 0;
+                values[i] = u8(parseHex(digits, q));
+            }
+
+            reg.a = values[0];
+            reg.x = values[1];
+            reg.y = values[2];
+            cpu.setP(values[3]);
+            reg.sp = values[4];
+            cpu.debugger.jump(LO_HI(values[5], values[6]));
+
+            result = "OK";
+            return true;
+        }
+        case 'p':
+
+            switch (parseHex(packet, pos)) {
+
+                case 0: result = hex8(reg.a); break;
+                case 1: result = hex8(reg.x); break;
+                case 2: result = hex8(reg.y); break;
+                case 3: result = hex8(cpu.getP()); break;
+                case 4: result = hex8(reg.sp); break;
+                case 5: result = hex8(LO_BYTE(reg.pc)) + hex8(HI_BYTE(reg.pc)); break;
+                default: result = "E01";
+            }
+            return true;
+
+        case 'P':
+        {
+            auto nr = parseHex(packet, pos);
+            if (pos >= packet.size() || packet[pos++] != '=') { result = "E01"; return true; }
+            auto value = parseHex(packet, pos);
+
+            switch (nr) {
+
+                case 0: reg.a = u8(value); break;
+                case 1: reg.x = u8(value); break;
+                case 2: reg.y = u8(value); break;
+                case 3: cpu.setP(u8(value)); break;
+                case 4: reg.sp = u8(value); break;
+                case 5: cpu.debugger.jump(u16((value & 0xFF) << 8 | (value >> 8 & 0xFF))); break;
+                default: result = "E01"; return true;
+            }
+            result = "OK";
+            return true;
+        }
+        case 'm':
+        {
+            auto addr = parseHex(packet, pos);
+            auto len = parseHex(packet, ++pos);
+
+            // Each byte is sent as two hex digits
+            for (u64 i = 0; i < len && i < packetSize / 2; i++) {
+                result += hex8(cpu.readDasm(u16(addr + i)));
+            }
+            return true;
+        }
+        case 'M':
+        {
+            auto addr = parseHex(packet, pos);
+            auto len = parseHex(packet, ++pos);
+            if (pos >= packet.size() || packet[pos++] != ':') { result = "E01"; return true; }
+
+            for (u64 i = 0; i < len && pos + 1 < packet.size(); i++, pos += 2) {
+
+                std::string digits = packet.substr(pos, 2);
+                size_t q = 0;
+                cpu.write(u16(addr + i), u8(parseHex(digits, q)));
+                cpu.disassembler.invalidate(u16(addr + i));
+                cpu.boundaries.invalidate(u16(addr + i));
+            }
+            result = "OK";
+            return true;
+        }
+        case 'c':
+        case 's':
+
+            if (pos < packet.size()) cpu.debugger.jump(u16(parseHex(packet, pos)));
+            if (packet[0] == 's') cpu.debugger.setSoftStop(UINT64_MAX);
+            halted = false;
+            return false;
+
+        case 'D':
+
+            halted = false;
+            result = "OK";
+            return true;
+
+        case 'k':
+
+            halted = false;
+            return false;
+
+        case 'Z':
+        case 'z':
+        {
+            auto type = parseHex(packet, pos);
+            auto addr = u32(parseHex(packet, ++pos));
+
+            if (type > 4) return true;
+
+            Guards &guards = type < 2 ?
+            static_cast<Guards &>(cpu.debugger.breakpoints) : cpu.debugger.watchpoints;
+
+            if (packet[0] == 'Z') guards.setAt(addr); else guards.removeAt(addr);
+            result = "OK";
+            return true;
+        }
+        case 'H':
+
+            result = "OK";
+            return true;
+
+        case 'q':
+
+            if (packet.starts_with("qSupported")) {
+                result = "PacketSize=" + hex8(HI_BYTE(packetSize)) + hex8(LO_BYTE(packetSize));
+            }
+            if (packet.starts_with("qAttached")) result = "1";
+            return true;
+
+        default:
+
+            // Unsupported packets are answered with an empty reply
+            return true;
+    }
+}
+
+void
+GdbServer::reply(std::string &&packet)
+{
+    // The client waits for each reply, so the queue never runs full
+    (void)replies.push(std::move(packet));
+}
+
+
+//
+// Running the server thread
+//
+
+void
+GdbServer::start()
+{
+    quit = false;
+    thread = std::thread(&GdbServer::run, this);
+}
+
+#ifdef _WIN32
+
+void GdbServer::run() { }
+void GdbServer::send(const std::string &packet) { }
+void GdbServer::disconnect() { }
+
+#else
+
+void
+GdbServer::run()
+{
+    std::string packet;
+    enum { IDLE, DATA, ESCAPE, CHECKSUM1, CHECKSUM2 } state = IDLE;
+    u8 sum = 0, expected = 0;
+
+    auto forward = [&](Command &&cmd) {
+        while (!commands.push(std::move(cmd)) && !quit) std::this_thread::yield();
+    };
+
+    while (!quit) {
+
+        if (clientFd < 0) {
+
+            pollfd pfd = { listenFd, POLLIN, 0 };
+            if (poll(&pfd, 1, 50) <= 0) continue;
+
+            clientFd = accept(listenFd, nullptr, nullptr);
+            if (clientFd < 0) continue;
+
+            state = IDLE;
+            attached = true;
+            forward(Command { GDB_ATTACH, { } });
+            continue;
+        }
+
+        // Forward all replies from the emulation thread
+        std::string reply;
+        while (replies.pop(reply)) send(reply);
+
+        pollfd pfd = { clientFd, POLLIN, 0 };
+        if (poll(&pfd, 1, 5) <= 0) continue;
+
+        char buffer[1024];
+        auto count = recv(clientFd, buffer, sizeof(buffer), 0);
+        if (count <= 0) { disconnect(); continue; }
+
+        for (isize i = 0; i < count; i++) {
+
+            char c = buffer[i];
+
+            switch (state) {
+
+                case IDLE:
+
+                    if (c == '$') { packet.clear(); sum = 0; state = DATA; }
+                    if (c == 0x03) forward(Command { GDB_INTERRUPT, { } });
+                    break;
+
+                case DATA:
+
+                    if (c == '#') { state = CHECKSUM1; break; }
+                    sum = u8(sum + u8(c));
+                    if (c == '}') { state = ESCAPE; break; }
+                    packet += c;
+                    break;
+
+                case ESCAPE:
+
+                    sum = u8(sum + u8(c));
+                    packet += char(c ^ 0x20);
+                    state = DATA;
+                    break;
+
+                case CHECKSUM1:
+                case CHECKSUM2:
+                {
+                    std::string digit(1, c);
+                    size_t pos = 0;
+                    expected = u8(expected << 4 | parseHex(digit, pos));
+
+                    if (state == CHECKSUM1) { state = CHECKSUM2; break; }
+                    state = IDLE;
+
+                    if (expected != sum) { (void)::send(clientFd, "-", 1, SEND_FLAGS); break; }
+                    (void)::send(clientFd, "+", 1, SEND_FLAGS);
+
+                    forward(Command { GDB_PACKET, packet });
+                    if (packet == "k") disconnect();
+                    break;
+                }
+            }
+            if (clientFd < 0) break;
+        }
+    }
+
+    if (clientFd >= 0) disconnect();
+}
+
+void
+GdbServer::send(const std::string &packet)
+{
+    auto frame = "$" + packet + "#" + hex8(checksum(packet));
+    (void)::send(clientFd, frame.data(), frame.size(), SEND_FLAGS);
+}
+
+void
+GdbServer::disconnect()
+{
+    close(clientFd);
+    clientFd = -1;
+    attached = false;
+
+    Command cmd { GDB_DETACH, { } };
+    while (!commands.push(std::move(cmd)) && !quit) std::this_thread::yield();
+}
+
+#endif
+
+}
@@ -0,0 +1,165 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include "PeddleUtils.h"
+#include <string>
+#include <thread>
+
+namespace peddle {
+
+peddle_enum_long(GDB_COMMAND)
+{
+    GDB_ATTACH,         // A client has connected
+    GDB_DETACH,         // The client has disconnected
+    GDB_INTERRUPT,      // The client has sent a break request (Ctrl-C)
+    GDB_PACKET          // The client has sent a packet
+};
+typedef GDB_COMMAND GdbCommand;
+
+/* GDB remote serial protocol server
+ *
+ * The server accepts a single client on a localhost TCP port or a Unix domain
+ * socket. The socket is served by a separate thread, which handles the packet
+ * framing and forwards all commands to the emulation thread through a
+ * lock-free queue. Replies are sent back the same way. The emulation thread
+ * executes commands in process(), which the host calls regularly, e.g., once
+ * per frame and repeatedly while the CPU is halted. If no command is pending,
+ * process() returns after a single atomic load.
+ *
+ * The host remains in charge of running the CPU. It must not execute any
+ * instructions while isHalted() returns true, and it has to forward its
+ * breakpointReached() and watchpointReached() callbacks to stopped().
+ *
+ * Supported packets:
+ *
+ *     ?, g, G, p, P, m, M, c, s, D, k, Z0-Z4, z0-z4, H, qSupported, qAttached
+ *
+ * Registers are transferred in the order A, X, Y, P, SP, PC. All registers
+ * are 8 bit wide except PC, which is 16 bit wide (little endian). Changing PC
+ * has the same effect as Debugger::jump(). Memory is read via readDasm() and
+ * written via write(). Memory reads are truncated to the packet size
+ * announced in the qSupported reply. Software and hardware
+ * breakpoints are mapped to Breakpoints, all kinds of watchpoints are mapped
+ * to Watchpoints, which trigger on reads and writes alike.
+ *
+ * The server is available on POSIX systems only. On other platforms, listen()
+ * throws an exception.
+ */
+class GdbServer {
+
+    struct Command {
+
+        GdbCommand type;
+        std::string packet;
+    };
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Maximum packet size announced to the client (without framing)
+    static constexpr isize packetSize = 0x400;
+
+    // Server thread
+    std::thread thread;
+
+    // Socket descriptors
+    int listenFd = -1;
+    int clientFd = -1;
+
+    // Path of the Unix domain socket (empty if TCP is used)
+    std::string socketPath;
+
+    // Communication channels between the server and the emulation thread
+    SPSCQueue <Command, 64> commands;
+    SPSCQueue <std::string, 64> replies;
+
+    // Indicates whether a client is connected
+    std::atomic<bool> attached = false;
+
+    // Indicates whether the CPU has been halted by the debugger
+    std::atomic<bool> halted = false;
+
+    // Termination request for the server thread
+    std::atomic<bool> quit = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    GdbServer(Peddle& ref) : cpu(ref) { }
+    ~GdbServer();
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Starts the server on a localhost TCP port
+    void listen(u16 port);
+
+    // Starts the server on a Unix domain socket
+    void listen(const std::string &path);
+
+    // Stops the server
+    void stop();
+
+    // Returns true if a client is connected
+    bool isAttached() const { return attached; }
+
+    // Returns true if the host must not run the CPU
+    bool isHalted() const { return halted; }
+
+
+    //
+    // Interfacing with the emulation thread
+    //
+
+public:
+
+    // Executes all pending commands
+    void process();
+
+    // Informs the client that the CPU has stopped at a breakpoint or watchpoint
+    void stopped();
+
+private:
+
+    // Executes a single packet and returns the reply (if any)
+    bool execute(const std::string &packet, std::string &reply);
+
+    // Sends a reply to the client
+    void reply(std::string &&packet);
+
+
+    //
+    // Running the server thread
+    //
+
+private:
+
+    // Starts the server thread
+    void start();
+
+    // Main function of the server thread
+    void run();
+
+    // Sends a framed packet to the client
+    void send(const std::string &packet);
+
+    // Closes the client connection
+    void disconnect();
+};
+
+}
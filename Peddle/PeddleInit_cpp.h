@@ -5,6 +5,36 @@
 // Published under the terms of the MIT License
 // -----------------------------------------------------------------------------
 
+static MemAccess
+memAccessOf(const char *mnemonic, AddressingMode mode)
+{
+    auto is = [&](const char *m) { return strncmp(mnemonic, m, 3) == 0; };
+
+    switch (mode) {
+
+        case ADDR_IMPLIED:
+        case ADDR_ACCUMULATOR:
+        case ADDR_IMMEDIATE:
+        case ADDR_RELATIVE:
+        case ADDR_DIRECT:
+
+            return ACCESS_NONE;
+
+        default:
+
+            if (is("STA") || is("STX") || is("STY") || is("SAX") ||
+                is("SHA") || is("SHX") || is("SHY") || is("TAS")) {
+                return ACCESS_WRITE;
+            }
+            if (is("ASL") || is("LSR") || is("ROL") || is("ROR") ||
+                is("INC") || is("DEC") || is("SLO") || is("SRE") ||
+                is("RLA") || is("RRA") || is("DCP") || is("ISC")) {
+                return ACCESS_MODIFY;
+            }
+            return ACCESS_READ;
+    }
+}
+
 void
 Peddle::registerCallback(u8 opcode, const char *mnemonic,
                          AddressingMode mode, MicroInstruction mInstr)
@@ -12,9 +42,10 @@ Peddle::registerCallback(u8 opcode, const char *mnemonic,
     // Table is write-once
     assert(mInstr == JAM || actionFunc[opcode] == JAM);
 
-    this->actionFunc[opcode] = mInstr;
-    this->mnemonic[opcode] = mnemonic;
-    this->addressingMode[opcode] = mode;
+    Peddle::actionFunc[opcode] = mInstr;
+    Peddle::mnemonic[opcode] = mnemonic;
+    Peddle::addressingMode[opcode] = mode;
+    Peddle::memAccess[opcode] = memAccessOf(mnemonic, mode);
 }
 
 void
@@ -0,0 +1,157 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <stdexcept>
+
+namespace peddle {
+
+Journal::~Journal()
+{
+    delete [] entries;
+    delete [] writes;
+}
+
+void
+Journal::reset()
+{
+    // Instructions executed prior to a reset cannot be undone
+    clear();
+    if (enabled) cpu.flags |= CPU_JOURNAL;
+}
+
+void
+Journal::enable(isize instructions)
+{
+    if (instructions < 1) throw std::runtime_error("journal capacity must be positive");
+
+    u64 size = 1;
+    while (size < u64(instructions)) size <<= 1;
+
+    if (size != capacity) {
+
+        delete [] entries;
+        delete [] writes;
+        entries = new JournalEntry[size];
+        writes = new JournalWrite[4 * size];
+        capacity = size;
+    }
+
+    clear();
+    enabled = true;
+    cpu.flags |= CPU_JOURNAL;
+}
+
+void
+Journal::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_JOURNAL;
+}
+
+void
+Journal::clear()
+{
+    entryCnt = writeCnt = oldest = oldestWrite = 0;
+    capture();
+}
+
+isize
+Journal::stepBack(isize n)
+{
+    isize result = 0;
+
+    for (; result < n && entryCnt > oldest; result++) {
+
+        auto &entry = entries[--entryCnt & (capacity - 1)];
+
+        // Restore memory in reverse order
+        for (isize i = 0; i < entry.writes; i++) {
+
+            auto &write = writes[--writeCnt & (4 * capacity - 1)];
+
+            if (write.addr < 2 && cpu.hasProcessorPort()) {
+                (write.addr ? cpu.reg.pport.data : cpu.reg.pport.direction) = write.value;
+            } else {
+                cpu.write(write.addr, write.value);
+            }
+            cpu.disassembler.invalidate(write.addr);
+            cpu.boundaries.invalidate(write.addr);
+        }
+
+        restore(entry);
+    }
+
+    if (result) cpu.jumpedTo(cpu.reg.pc);
+    return result;
+}
+
+bool
+Journal::stepBackToWrite(u16 addr)
+{
+    u64 w = writeCnt;
+
+    for (u64 nr = entryCnt; nr > oldest; nr--) {
+
+        auto &entry = entries[(nr - 1) & (capacity - 1)];
+
+        for (isize i = 0; i < entry.writes; i++) {
+
+            if (writes[--w & (4 * capacity - 1)].addr == addr) {
+
+                stepBack(isize(entryCnt - nr + 1));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void
+Journal::record(u16 addr)
+{
+    u8 value;
+
+    if (addr < 2 && cpu.hasProcessorPort()) {
+        value = addr ? cpu.reg.pport.data : cpu.reg.pport.direction;
+    } else {
+        value = cpu.readDasm(addr);
+    }
+
+    writes[writeCnt++ & (4 * capacity - 1)] = JournalWrite { addr, value };
+    current.writes++;
+}
+
+void
+Journal::capture()
+{
+    current.pc = cpu.reg.pc;
+    current.sp = cpu.reg.sp;
+    current.a = cpu.reg.a;
+    current.x = cpu.reg.x;
+    current.y = cpu.reg.y;
+    current.flags = cpu.getP();
+    current.writes = 0;
+}
+
+void
+Journal::restore(const JournalEntry &entry)
+{
+    cpu.reg.pc = entry.pc;
+    cpu.reg.pc0 = entry.pc;
+    cpu.reg.sp = entry.sp;
+    cpu.reg.a = entry.a;
+    cpu.reg.x = entry.x;
+    cpu.reg.y = entry.y;
+    cpu.setP(entry.flags);
+    cpu.next = fetch;
+
+    capture();
+}
+
+}
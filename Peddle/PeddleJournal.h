@@ -0,0 +1,171 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+
+namespace peddle {
+
+// Register state at an instruction boundary
+struct JournalEntry {
+
+    u16 pc;
+    u8 sp;
+    u8 a;
+    u8 x;
+    u8 y;
+    u8 flags;
+
+    // Number of memory writes performed by the following instruction
+    u16 writes;
+};
+
+// A single undo record for a memory write
+struct JournalWrite {
+
+    // The written address
+    u16 addr;
+
+    // The value before the write
+    u8 value;
+};
+
+/* Undo journal
+ *
+ * The journal enables reverse stepping. For each executed instruction, it
+ * records the register state prior to the instruction and, for each memory
+ * write performed by the instruction, the address and the overwritten value.
+ * Both are stored in ring buffers of fixed size which are allocated when the
+ * journal is enabled. Hence, recording never allocates memory, and the oldest
+ * instructions are silently dropped when either buffer is full. Because an
+ * instruction writes at most three bytes, the write buffer is sized such that
+ * it usually covers all instructions in the instruction buffer.
+ *
+ * Commands of the command queue and trap handlers are considered part of the
+ * preceding instruction. Stepping back over an instruction restores the state
+ * prior to the instruction, and the trap is handled again when the instruction
+ * is executed again. A trap handler that modifies memory must call
+ * recordWrite() prior to each write to make the write revertible.
+ *
+ * Stepping back restores the registers and the overwritten memory cells. The
+ * old values are obtained via readDasm() and restored via write(). Hence,
+ * side effects of I/O registers are not reverted. The clock and the state of
+ * the interrupt lines are not reverted either. Stepping back is only allowed
+ * at instruction boundaries.
+ *
+ * If the simple memory API or the memory hooks are disabled, the host provides
+ * the write functions and is responsible for calling recordWrite() prior to
+ * each write.
+ */
+class Journal {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Instruction ring buffer (capacity is a power of two)
+    JournalEntry *entries = nullptr;
+    u64 capacity = 0;
+
+    // Write ring buffer (four times the capacity of the instruction buffer)
+    JournalWrite *writes = nullptr;
+
+    // Total number of recorded instructions and writes
+    u64 entryCnt = 0;
+    u64 writeCnt = 0;
+
+    // Index of the oldest instruction that can be undone and its first write
+    u64 oldest = 0;
+    u64 oldestWrite = 0;
+
+    // Register state prior to the currently executed instruction
+    JournalEntry current = { };
+
+    // Indicates whether recording is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Journal(Peddle& ref) : cpu(ref) { }
+    ~Journal();
+
+    void reset();
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns recording on or off (the capacity is rounded up to a power of two)
+    void enable(isize instructions = 65536);
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Discards all recorded instructions
+    void clear();
+
+
+    //
+    // Stepping back
+    //
+
+public:
+
+    // Returns the number of instructions that can be undone
+    isize available() const { return isize(entryCnt - oldest); }
+
+    // Undoes the last n instructions and returns the number of undone ones
+    isize stepBack(isize n = 1);
+
+    // Undoes all instructions up to and including the last write to an address
+    bool stepBackToWrite(u16 addr);
+
+
+    //
+    // Recording
+    //
+
+public:
+
+    // Called prior to each memory write that isn't performed by the CPU
+    void recordWrite(u16 addr) { if (enabled) record(addr); }
+
+
+private:
+
+    // Called at the end of each instruction or interrupt sequence
+    void recordInstruction() {
+
+        entries[entryCnt & (capacity - 1)] = current;
+        entryCnt++;
+        while (entryCnt - oldest > capacity || writeCnt - oldestWrite > 4 * capacity) drop();
+        capture();
+    }
+
+    // Called prior to each memory write performed by the CPU
+    void record(u16 addr);
+
+    // Forgets the oldest instruction
+    void drop() { oldestWrite += entries[oldest++ & (capacity - 1)].writes; }
+
+    // Saves the current register state
+    void capture();
+
+    // Restores a register state
+    void restore(const JournalEntry &entry);
+};
+
+}
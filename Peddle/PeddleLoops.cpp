@@ -0,0 +1,302 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace peddle {
+
+void
+LoopAccelerator::map(u8 first, isize count, const u8 *read, u8 *write)
+{
+    for (isize i = 0; i < count && first + i < 256; i++) {
+
+        readMap[first + i] = read ? read + 256 * i : nullptr;
+        writeMap[first + i] = write ? write + 256 * i : nullptr;
+    }
+}
+
+void
+LoopAccelerator::unmap(u8 first, isize count)
+{
+    map(first, count, nullptr, nullptr);
+}
+
+void
+LoopAccelerator::unmapAll()
+{
+    unmap(0, 256);
+}
+
+bool
+LoopAccelerator::isSuspended() const
+{
+    return cpu.flags & ~CPU_CHECK_TRAP;
+}
+
+i64
+LoopAccelerator::accelerate(u16 addr, i64 limit)
+{
+    auto &reg = cpu.reg;
+
+    // Interrupts and the RDY line need to be served cycle by cycle
+    if (cpu.rdyLine || cpu.doNmi || cpu.doIrq) return 0;
+    if (cpu.edgeDetector.current() || cpu.edgeDetector.delayed()) return 0;
+    if (!cpu.getI() && (cpu.irqLine || cpu.levelDetector.current() || cpu.levelDetector.delayed())) return 0;
+
+    mask = cpu.addrMask();
+    port = cpu.hasProcessorPort();
+
+    Loop loop;
+    if (!decode(addr, loop)) return 0;
+
+    // Leave loops containing a trapped address to the regular path
+    if (cpu.flags & CPU_CHECK_TRAP) {
+        for (u16 a = loop.start; a != loop.end; a++) if (cpu.traps.isSet(a)) return 0;
+    }
+
+    // Determine the remaining iterations
+    bool x = loop.store.opcode == 0x9D;
+    u8 index = x ? reg.x : reg.y;
+    isize count = loop.up ? 256 - index : (index ? index : 256);
+    isize step = loop.up ? 1 : -1;
+
+    // Each iteration consists of three or four instructions
+    i64 instructions = count * (loop.load.opcode ? 4 : 3);
+    if (instructions > limit) return 0;
+
+    // Make sure that all iterations access plain memory only
+    i64 cycles = 0;
+    for (isize i = 0; i < count; i++) {
+        if (!check(loop, u8(index + step * i), i == count - 1, cycles)) return 0;
+    }
+
+    // Transfer the data (the index register wraps around when counting down from 0)
+    if (!loop.up && index == 0) {
+
+        transfer(loop, 0, 1, step);
+        transfer(loop, 0xFF, count - 1, step);
+
+    } else {
+
+        transfer(loop, index, count, step);
+    }
+
+    // Leave the registers in the state of the last iteration
+    u8 last = u8(index + step * (count - 1));
+    u16 dst = u16(loop.store.base + last);
+
+    if (loop.load.opcode) reg.a = *readable(u16(loop.load.base + last));
+    if (x) reg.x = 0; else reg.y = 0;
+    reg.sr.n = 0;
+    reg.sr.z = 1;
+    reg.d = loop.offset;
+    reg.adl = LO_BYTE(dst);
+    reg.adh = HI_BYTE(dst);
+    reg.ovl = (loop.store.base & 0xFF) + last > 0xFF;
+    if (loop.store.opcode == 0x91) {
+        reg.idl = u8(loop.store.zp + 2);
+    } else if (loop.load.opcode == 0xB1) {
+        reg.idl = u8(loop.load.zp + 2);
+    }
+
+    reg.pc = loop.end;
+    cpu.clock += cycles;
+
+    // Check the instruction following the loop for a trap like done() does
+    if ((cpu.flags & CPU_CHECK_TRAP) && cpu.traps.isSet(reg.pc)) {
+
+        reg.pc = cpu.trapReached(reg.pc, cpu.traps.id(reg.pc));
+    }
+    reg.pc0 = reg.pc;
+
+    loops++;
+    iterations += count;
+    return instructions;
+}
+
+bool
+LoopAccelerator::decode(u16 addr, Loop &loop) const
+{
+    loop = { };
+    loop.start = addr;
+
+    u8 opcode;
+    if (!peek(addr, opcode)) return false;
+
+    // Optional load
+    if (opcode == 0xBD || opcode == 0xB9 || opcode == 0xB1) {
+        if (!decode(addr, loop.load)) return false;
+    }
+
+    // Store
+    if (!decode(addr, loop.store)) return false;
+    if (loop.store.opcode != 0x9D && loop.store.opcode != 0x99 && loop.store.opcode != 0x91) return false;
+
+    // Both accesses must be indexed by the same register
+    bool x = loop.store.opcode == 0x9D;
+    if (loop.load.opcode && x != (loop.load.opcode == 0xBD)) return false;
+
+    // Count the index register
+    if (!peek(addr++, opcode)) return false;
+    switch (opcode) {
+
+        case 0xE8: if (!x) return false; loop.up = true; break;
+        case 0xCA: if (!x) return false; loop.up = false; break;
+        case 0xC8: if (x) return false; loop.up = true; break;
+        case 0x88: if (x) return false; loop.up = false; break;
+
+        default:
+            return false;
+    }
+
+    // Branch back
+    if (!peek(addr++, opcode) || opcode != 0xD0) return false;
+    if (!peek(addr++, loop.offset)) return false;
+    if (u16(addr + (i8)loop.offset) != loop.start) return false;
+    loop.end = addr;
+
+    // The instruction following BNE is touched by an idle read
+    return readable(loop.end) != nullptr;
+}
+
+bool
+LoopAccelerator::decode(u16 &addr, Access &access) const
+{
+    u8 lo, hi;
+
+    if (!peek(addr++, access.opcode)) return false;
+    switch (access.opcode) {
+
+        case 0xBD: case 0xB9: case 0x9D: case 0x99:
+
+            if (!peek(addr++, lo) || !peek(addr++, hi)) return false;
+            break;
+
+        case 0xB1: case 0x91:
+
+            if (!peek(addr++, access.zp)) return false;
+            if (!peek(access.zp, lo) || !peek(u8(access.zp + 1), hi)) return false;
+            break;
+
+        default:
+            return false;
+    }
+
+    access.base = LO_HI(lo, hi);
+    return true;
+}
+
+bool
+LoopAccelerator::check(const Loop &loop, u8 index, bool last, i64 &cycles) const
+{
+    // Load (reads from the unfixed address first if a page boundary is crossed)
+    if (auto &load = loop.load; load.opcode) {
+
+        u16 addr = u16(load.base + index);
+        bool crossed = (load.base & 0xFF) + index > 0xFF;
+        if (!readable(addr) || !readable(u16((load.base & 0xFF00) | (addr & 0xFF)))) return false;
+
+        cycles += (load.opcode == 0xB1 ? 5 : 4) + crossed;
+    }
+
+    // Store (always reads from the unfixed address first)
+    {
+        auto &store = loop.store;
+
+        u16 addr = u16(store.base + index);
+        if (!writable(addr) || !readable(u16((store.base & 0xFF00) | (addr & 0xFF)))) return false;
+
+        // Don't overwrite the code or the zero page pointers
+        if (((addr - loop.start) & mask) < ((loop.end - loop.start) & mask)) return false;
+        if (loop.load.opcode == 0xB1 && ((addr & mask) == loop.load.zp || (addr & mask) == u8(loop.load.zp + 1))) return false;
+        if (store.opcode == 0x91 && ((addr & mask) == store.zp || (addr & mask) == u8(store.zp + 1))) return false;
+
+        cycles += store.opcode == 0x91 ? 6 : 5;
+    }
+
+    // Counter and branch
+    cycles += 2;
+    cycles += last ? 2 : HI_BYTE(loop.end) != HI_BYTE(loop.start) ? 4 : 3;
+
+    return true;
+}
+
+void
+LoopAccelerator::transfer(const Loop &loop, u8 index, isize count, isize step)
+{
+    while (count > 0) {
+
+        u16 src = u16(loop.load.base + index);
+        u16 dst = u16(loop.store.base + index);
+
+        // Determine how many iterations stay on the current pages
+        auto remaining = [step](u16 addr) { return step > 0 ? 256 - (addr & 0xFF) : (addr & 0xFF) + 1; };
+        isize n = std::min(count, isize(remaining(dst)));
+        if (loop.load.opcode) n = std::min(n, isize(remaining(src)));
+
+        // Transfer the bytes (d and s point to the lowest addresses)
+        u8 *d = writable(dst) - (step > 0 ? 0 : n - 1);
+
+        if (!loop.load.opcode) {
+
+            memset(d, cpu.reg.a, n);
+
+        } else {
+
+            const u8 *s = readable(src) - (step > 0 ? 0 : n - 1);
+
+            // memmove() is only wrong if source bytes are overwritten before being read
+            auto sa = uintptr_t(s), da = uintptr_t(d);
+            bool clash = step > 0 ? (sa < da && da < sa + n) : (da < sa && sa < da + n);
+
+            if (!clash) {
+                memmove(d, s, n);
+            } else if (step > 0) {
+                for (isize i = 0; i < n; i++) d[i] = s[i];
+            } else {
+                for (isize i = n - 1; i >= 0; i--) d[i] = s[i];
+            }
+        }
+
+        index = u8(index + step * n);
+        count -= n;
+    }
+}
+
+const u8 *
+LoopAccelerator::readable(u16 addr) const
+{
+    addr &= mask;
+    if (addr < 2 && port) return nullptr;
+
+    auto *page = readMap[addr >> 8];
+    return page ? page + (addr & 0xFF) : nullptr;
+}
+
+u8 *
+LoopAccelerator::writable(u16 addr) const
+{
+    addr &= mask;
+    if (addr < 2 && port) return nullptr;
+
+    auto *page = writeMap[addr >> 8];
+    return page ? page + (addr & 0xFF) : nullptr;
+}
+
+bool
+LoopAccelerator::peek(u16 addr, u8 &value) const
+{
+    auto *p = readable(addr);
+    if (p) value = *p;
+    return p != nullptr;
+}
+
+}
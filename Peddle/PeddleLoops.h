@@ -0,0 +1,193 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+
+namespace peddle {
+
+/* Loop acceleration
+ *
+ * Copy and fill loops like
+ *
+ *     loop: LDA src,X          loop: STA (dst),Y
+ *           STA dst,X                INY
+ *           INX                      BNE loop
+ *           BNE loop
+ *
+ * spend most of their cycles in bookkeeping. In instruction mode
+ * (executeInstruction()), the accelerator recognizes such loops when the CPU
+ * is about to fetch their first instruction and runs all remaining iterations
+ * natively in a single call. A loop consists of an optional load (LDA),
+ * a store (STA), an instruction counting the index register up or down, and a
+ * BNE back to the load or store. Both operands are indexed by the counted
+ * register. They are either absolute indexed or, if Y is counted, indirect
+ * indexed. Afterwards, the registers are in the state the last iteration
+ * leaves them in, and the clock has been advanced by the number of cycles
+ * the iterations would have taken, including all page crossing penalties.
+ * executeInstruction(count) only runs a loop natively if all remaining
+ * instructions of the loop fit into the count.
+ *
+ * Peddle does not know which addresses are connected to plain memory. Hence,
+ * the host declares such pages by mapping them to host memory. Pages may be
+ * mapped for reading, for writing, or both, using different host memory for
+ * reads and writes if needed (e.g., RAM under ROM). A loop is accelerated only
+ * if the code and all accessed addresses, including the dummy reads of the
+ * indexed addressing modes, lie on mapped pages. The stores must not
+ * overwrite the loop code or its zero page pointers. On CPUs with a processor
+ * port, $0000 and $0001 are never treated as plain memory.
+ *
+ * Since the native iterations don't access the bus, they are only run if all
+ * state flags except CPU_CHECK_TRAP are cleared (hence, no watchpoints are
+ * set), no address of the loop is trapped, the RDY line is up, and no
+ * interrupt is pending or about to be triggered by an interrupt line that is
+ * already pulled down. Like fusion, acceleration is suspended by every
+ * enabled component hooking into the memory interface or into done(),
+ * including the profiler, the sampler, the execution statistics, the state
+ * publisher, and the command queue (see isSuspended()). A trap at the
+ * instruction following the loop fires as usual. The host must not depend on
+ * observing the cycles of a loop one by one, e.g., to trigger an interrupt in
+ * the middle of it. If it does, the accelerator has to stay disabled.
+ */
+class LoopAccelerator {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // An indexed memory access
+    struct Access {
+
+        // Opcode (0 if the access is absent)
+        u8 opcode;
+
+        // Zero page pointer (indirect indexed mode)
+        u8 zp;
+
+        // Base address
+        u16 base;
+    };
+
+    // A recognized loop
+    struct Loop {
+
+        Access load;
+        Access store;
+
+        // Address of the first instruction and the instruction following BNE
+        u16 start;
+        u16 end;
+
+        // Branch offset
+        u8 offset;
+
+        // Indicates whether the index register is counted up
+        bool up;
+    };
+
+    // Host memory of mapped pages
+    const u8 *readMap[256] = { };
+    u8 *writeMap[256] = { };
+
+    // Indicates whether acceleration is enabled
+    bool enabled = false;
+
+    // Properties of the CPU model (updated with each loop)
+    u16 mask = 0xFFFF;
+    bool port = false;
+
+    // Number of accelerated loops and iterations
+    u64 loops = 0;
+    u64 iterations = 0;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    LoopAccelerator(Peddle& ref) : cpu(ref) { }
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns acceleration on or off
+    void enable() { enabled = true; }
+    void disable() { enabled = false; }
+    bool isEnabled() const { return enabled; }
+
+    // Checks whether a state flag prevents loops from being accelerated
+    bool isSuspended() const;
+
+    // Declares pages as plain memory (read or write may be nullptr)
+    void map(u8 first, isize count, const u8 *read, u8 *write);
+    void map(u8 first, isize count, u8 *mem) { map(first, count, mem, mem); }
+
+    // Withdraws the declaration
+    void unmap(u8 first, isize count);
+    void unmapAll();
+
+    // Returns the number of accelerated loops and iterations
+    u64 acceleratedLoops() const { return loops; }
+    u64 acceleratedIterations() const { return iterations; }
+
+
+    //
+    // Executing
+    //
+
+private:
+
+    // Runs a loop natively if one starts at the given address and completes at
+    // most limit instructions. Returns the number of completed instructions.
+    i64 execute(u16 addr, i64 limit) { return isLoopStart(addr) ? accelerate(addr, limit) : 0; }
+
+    // Checks whether an address holds an opcode a loop can start with
+    bool isLoopStart(u16 addr) const {
+
+        auto *page = readMap[addr >> 8];
+        if (!page) return false;
+
+        switch (page[addr & 0xFF]) {
+
+            case 0xBD: case 0xB9: case 0xB1: case 0x9D: case 0x99: case 0x91:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    // Recognizes and runs a loop
+    i64 accelerate(u16 addr, i64 limit);
+
+    // Recognizes a loop
+    bool decode(u16 addr, Loop &loop) const;
+    bool decode(u16 &addr, Access &access) const;
+
+    // Checks whether an iteration only accesses plain memory and adds its cycles
+    bool check(const Loop &loop, u8 index, bool last, i64 &cycles) const;
+
+    // Performs the memory transfers of consecutive iterations
+    void transfer(const Loop &loop, u8 index, isize count, isize step);
+
+    // Returns the host memory of an address (nullptr if not plain memory)
+    const u8 *readable(u16 addr) const;
+    u8 *writable(u16 addr) const;
+
+    // Reads a byte from plain memory
+    bool peek(u16 addr, u8 &value) const;
+};
+
+}
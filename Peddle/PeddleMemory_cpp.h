@@ -5,18 +5,108 @@
 // Published under the terms of the MIT License
 // -----------------------------------------------------------------------------
 
+// Flags that need to be checked on each memory access
+#define MEMORY_HOOKS \
+((PEDDLE_ENABLE_WATCHPOINTS ? CPU_CHECK_WP : 0) | (PEDDLE_ENABLE_MEMORY_HOOKS ? CPU_MEMORY_HOOKS : 0))
+
 #define CHECK_WATCHPOINT \
 if constexpr (PEDDLE_ENABLE_WATCHPOINTS) { \
 if ((flags & CPU_CHECK_WP) && debugger.watchpointMatches(addr)) { \
 watchpointReached(addr); \
 }}
 
+#define TRACK_COVERAGE(a,kind) \
+if (PEDDLE_ENABLE_MEMORY_HOOKS && (flags & CPU_TRACK_COVERAGE)) { coverage.record(a, kind); }
+
+#define RECORD_WRITE(a) \
+if (PEDDLE_ENABLE_MEMORY_HOOKS && (flags & CPU_JOURNAL)) { journal.record(a); }
+
+#define TRACK_XREF(a,kind) \
+if (PEDDLE_ENABLE_MEMORY_HOOKS && (flags & CPU_TRACK_XREFS)) { xrefs.record(reg.pc0, a, kind); }
+
+#define TRACK_BOUNDARIES(a) \
+if (PEDDLE_ENABLE_MEMORY_HOOKS && (flags & CPU_TRACK_BOUNDARIES)) { boundaries.invalidate(a); }
+
 #if PEDDLE_SIMPLE_MEMORY_API == true
 
+template <CPURevision C> u8
+Peddle::fetchOpcode(u16 addr)
+{
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+        TRACK_COVERAGE(addr & addrMask<C>(), COVERAGE_OPCODE)
+    }
+
+    if (hasProcessorPort<C>()) {
+
+        if (addr < 2) return addr ? readPort() : readPortDir();
+    }
+    return read(addr & addrMask<C>());
+}
+
+template <CPURevision C> u8
+Peddle::fetchOperand(u16 addr)
+{
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+        TRACK_COVERAGE(addr & addrMask<C>(), COVERAGE_OPERAND)
+    }
+
+    if (hasProcessorPort<C>()) {
+
+        if (addr < 2) return addr ? readPort() : readPortDir();
+    }
+    return read(addr & addrMask<C>());
+}
+
 template <CPURevision C> u8
 Peddle::read(u16 addr)
 {
-    CHECK_WATCHPOINT
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+        TRACK_COVERAGE(addr & addrMask<C>(), COVERAGE_READ)
+        TRACK_XREF(addr & addrMask<C>(), XREF_READ)
+    }
+
+    if (hasProcessorPort<C>()) {
+
+        if (addr < 2) return addr ? readPort() : readPortDir();
+    }
+    return read(addr & addrMask<C>());
+}
+
+template <CPURevision C> u8
+Peddle::readIndexed(u16 addr)
+{
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+
+        // Reading from an address whose high byte hasn't been fixed is a dummy read
+        if (!reg.ovl) {
+
+            TRACK_COVERAGE(addr & addrMask<C>(), COVERAGE_READ)
+            TRACK_XREF(addr & addrMask<C>(), XREF_READ)
+        }
+    }
+
+    if (hasProcessorPort<C>()) {
+
+        if (addr < 2) return addr ? readPort() : readPortDir();
+    }
+    return read(addr & addrMask<C>());
+}
+
+template <CPURevision C> u8
+Peddle::readDummy(u16 addr)
+{
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+    }
 
     if (hasProcessorPort<C>()) {
 
@@ -28,7 +118,12 @@ Peddle::read(u16 addr)
 template <CPURevision C> u8
 Peddle::readZeroPage(u8 addr)
 {
-    CHECK_WATCHPOINT
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+        TRACK_COVERAGE(addr, COVERAGE_READ)
+        TRACK_XREF(addr, XREF_READ)
+    }
 
     if (hasProcessorPort<C>()) {
 
@@ -40,7 +135,11 @@ Peddle::readZeroPage(u8 addr)
 template <CPURevision C> u8
 Peddle::readStack(u8 addr)
 {
-    CHECK_WATCHPOINT
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+        TRACK_COVERAGE(u16(addr) + 0x100, COVERAGE_READ)
+    }
     return read(u16(addr) + 0x100);
 }
 
@@ -49,7 +148,10 @@ Peddle::readIdle(u16 addr)
 {
     if (PEDDLE_EMULATE_IDLE_ACCESSES) {
 
-        CHECK_WATCHPOINT
+        if (unlikely(flags & MEMORY_HOOKS)) {
+
+            CHECK_WATCHPOINT
+        }
 
         if (hasProcessorPort<C>()) {
 
@@ -64,7 +166,10 @@ Peddle::readZeroPageIdle(u8 addr)
 {
     if (PEDDLE_EMULATE_IDLE_ACCESSES) {
 
-        CHECK_WATCHPOINT
+        if (unlikely(flags & MEMORY_HOOKS)) {
+
+            CHECK_WATCHPOINT
+        }
 
         if (hasProcessorPort<C>()) {
 
@@ -79,7 +184,10 @@ Peddle::readStackIdle(u8 addr)
 {
     if (PEDDLE_EMULATE_IDLE_ACCESSES) {
 
-        CHECK_WATCHPOINT
+        if (unlikely(flags & MEMORY_HOOKS)) {
+
+            CHECK_WATCHPOINT
+        }
         (void)read(u16(addr) + 0x100);
     }
 }
@@ -87,7 +195,14 @@ Peddle::readStackIdle(u8 addr)
 template <CPURevision C> void
 Peddle::write(u16 addr, u8 val)
 {
-    CHECK_WATCHPOINT
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+        TRACK_COVERAGE(addr & addrMask<C>(), COVERAGE_WRITE)
+        TRACK_XREF(addr & addrMask<C>(), XREF_WRITE)
+        RECORD_WRITE(addr & addrMask<C>())
+        TRACK_BOUNDARIES(addr & addrMask<C>())
+    }
 
     if (hasProcessorPort<C>()) {
 
@@ -99,7 +214,14 @@ Peddle::write(u16 addr, u8 val)
 template <CPURevision C> void
 Peddle::writeZeroPage(u8 addr, u8 val)
 {
-    CHECK_WATCHPOINT
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+        TRACK_COVERAGE(addr, COVERAGE_WRITE)
+        TRACK_XREF(addr, XREF_WRITE)
+        RECORD_WRITE(addr)
+        TRACK_BOUNDARIES(addr)
+    }
 
     if (hasProcessorPort<C>()) {
 
@@ -111,7 +233,13 @@ Peddle::writeZeroPage(u8 addr, u8 val)
 template <CPURevision C> void
 Peddle::writeStack(u8 addr, u8 val)
 {
-    CHECK_WATCHPOINT
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        CHECK_WATCHPOINT
+        TRACK_COVERAGE(u16(addr) + 0x100, COVERAGE_WRITE)
+        RECORD_WRITE(u16(addr) + 0x100)
+        TRACK_BOUNDARIES(u16(addr) + 0x100)
+    }
     write(u16(addr) + 0x100, val);
 }
 
@@ -124,6 +252,40 @@ Peddle::readResetVector()
 }
 */
 
+#else
+
+template <CPURevision C> u8
+Peddle::fetchOpcode(u16 addr)
+{
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        TRACK_COVERAGE(addr & addrMask<C>(), COVERAGE_OPCODE)
+    }
+    return read<C>(addr);
+}
+
+template <CPURevision C> u8
+Peddle::fetchOperand(u16 addr)
+{
+    if (unlikely(flags & MEMORY_HOOKS)) {
+
+        TRACK_COVERAGE(addr & addrMask<C>(), COVERAGE_OPERAND)
+    }
+    return read<C>(addr);
+}
+
+template <CPURevision C> u8
+Peddle::readIndexed(u16 addr)
+{
+    return read<C>(addr);
+}
+
+template <CPURevision C> u8
+Peddle::readDummy(u16 addr)
+{
+    return read<C>(addr);
+}
+
 #endif
 
 u16
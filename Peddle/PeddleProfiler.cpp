@@ -0,0 +1,116 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+
+namespace peddle {
+
+Profiler::~Profiler()
+{
+    delete [] counters;
+}
+
+void
+Profiler::reset()
+{
+    lastClock = cpu.clock;
+    if (enabled) cpu.flags |= CPU_PROFILE;
+}
+
+void
+Profiler::enable()
+{
+    if (!counters) {
+
+        counters = new ProfileCounter[65536];
+        clear();
+    }
+
+    lastClock = cpu.clock;
+    enabled = true;
+    cpu.flags |= CPU_PROFILE;
+}
+
+void
+Profiler::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_PROFILE;
+}
+
+void
+Profiler::clear()
+{
+    if (counters) std::memset(counters, 0, 65536 * sizeof(ProfileCounter));
+    interruptCycles = 0;
+}
+
+ProfileCounter
+Profiler::counter(u16 pc) const
+{
+    return counters ? counters[pc] : ProfileCounter { };
+}
+
+ProfileCounter
+Profiler::total() const
+{
+    ProfileCounter result = { };
+
+    for (isize i = 0; counters && i < 65536; i++) {
+
+        result.hits += counters[i].hits;
+        result.cycles += counters[i].cycles;
+    }
+    return result;
+}
+
+void
+Profiler::exportCallgrind(std::ostream &os) const
+{
+    auto sum = total();
+
+    os << "# callgrind format" << "\n";
+    os << "version: 1" << "\n";
+    os << "creator: Peddle" << "\n";
+    os << "positions: instr" << "\n";
+    os << "events: Ir Cycles" << "\n";
+    os << "summary: " << sum.hits << " " << sum.cycles + interruptCycles << "\n\n";
+    os << "ob=" << "6502" << "\n";
+    os << "fl=" << "memory" << "\n";
+
+    char str[64];
+    auto format = Disassembler::compile("%p: %i");
+
+    for (isize pc = 0; counters && pc < 65536; pc++) {
+
+        auto &counter = counters[pc];
+        if (!counter.hits) continue;
+
+        // Use the disassembled instruction as symbol name
+        RecordedInstruction instr = {
+
+            .byte1 = cpu.readDasm(u16(pc)),
+            .byte2 = cpu.readDasm(u16(pc + 1)),
+            .byte3 = cpu.readDasm(u16(pc + 2)),
+            .pc = u16(pc)
+        };
+        cpu.disassembler.disass(str, format, instr);
+
+        os << "fn=" << str << "\n";
+        os << "0x" << std::hex << pc << std::dec;
+        os << " " << counter.hits << " " << counter.cycles << "\n";
+    }
+
+    if (interruptCycles) {
+
+        os << "fn=" << "Interrupt sequences" << "\n";
+        os << "0 0 " << interruptCycles << "\n";
+    }
+}
+
+}
@@ -0,0 +1,121 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <iostream>
+
+namespace peddle {
+
+// Execution statistics of a single instruction
+struct ProfileCounter {
+
+    // Number of times the instruction has been executed
+    u64 hits;
+
+    // Number of elapsed cycles
+    u64 cycles;
+};
+
+/* Flat execution profiler
+ *
+ * The profiler accumulates the number of executions and the number of
+ * elapsed cycles for each program counter. The counters are updated at the
+ * end of each instruction. The number of cycles is derived from the clock
+ * delta between two consecutive instructions. Cycles spent in interrupt
+ * sequences are not assigned to any instruction and counted separately.
+ */
+class Profiler {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Counter array with one entry per program counter (64K entries)
+    ProfileCounter *counters = nullptr;
+
+    // Number of cycles spent in interrupt sequences
+    u64 interruptCycles = 0;
+
+    // Clock value at the end of the previous instruction
+    i64 lastClock = 0;
+
+    // Indicates whether profiling is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Profiler(Peddle& ref) : cpu(ref) { }
+    ~Profiler();
+
+    void reset();
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns profiling on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Zeroes out all counters
+    void clear();
+
+
+    //
+    // Analyzing
+    //
+
+public:
+
+    // Returns the counters of a single instruction
+    ProfileCounter counter(u16 pc) const;
+
+    // Returns the accumulated counters of all instructions
+    ProfileCounter total() const;
+
+    // Returns the number of cycles spent in interrupt sequences
+    u64 getInterruptCycles() const { return interruptCycles; }
+
+    // Exports the profile in Callgrind format
+    void exportCallgrind(std::ostream &os) const;
+
+
+    //
+    // Recording
+    //
+
+private:
+
+    // Called at the end of each instruction
+    void recordInstruction(u16 pc, i64 clock) {
+
+        counters[pc].hits++;
+        counters[pc].cycles += u64(clock - lastClock);
+        lastClock = clock;
+    }
+
+    // Called at the end of each interrupt sequence
+    void recordInterrupt(i64 clock) {
+
+        interruptCycles += u64(clock - lastClock);
+        lastClock = clock;
+    }
+};
+
+}
@@ -0,0 +1,99 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace peddle {
+
+void
+Publisher::reset()
+{
+    nextPublish = 0;
+    if (enabled) cpu.flags |= CPU_PUBLISH_STATE;
+}
+
+void
+Publisher::enable(i64 cycles)
+{
+    if (cycles < 0) throw std::runtime_error("publishing interval must not be negative");
+
+    interval = cycles;
+    nextPublish = 0;
+    enabled = true;
+    cpu.flags |= CPU_PUBLISH_STATE;
+}
+
+void
+Publisher::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_PUBLISH_STATE;
+}
+
+void
+Publisher::publish()
+{
+    Snapshot snapshot = { };
+    u64 buffer[words] = { };
+
+    snapshot.clock = cpu.clock;
+    snapshot.reg = cpu.reg;
+    snapshot.flags = cpu.flags;
+    snapshot.irqLine = cpu.irqLine;
+    snapshot.nmiLine = cpu.nmiLine;
+    snapshot.rdyLine = cpu.rdyLine;
+
+    isize count = cpu.debugger.loggedInstructions();
+    if (count > SNAPSHOT_LOG_ENTRIES) count = SNAPSHOT_LOG_ENTRIES;
+    snapshot.logCnt = count;
+    for (isize i = 0; i < count; i++) {
+        snapshot.log[i] = cpu.debugger.logEntryRel(count - 1 - i);
+    }
+    std::memcpy(buffer, &snapshot, sizeof(Snapshot));
+
+    // Only the emulation thread writes, hence a relaxed load suffices
+    u64 s = seq.load(std::memory_order_relaxed);
+
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (isize i = 0; i < words; i++) {
+        data[i].store(buffer[i], std::memory_order_relaxed);
+    }
+
+    seq.store(s + 2, std::memory_order_release);
+
+    nextPublish = cpu.clock + interval;
+}
+
+bool
+Publisher::read(Snapshot &snapshot) const
+{
+    u64 buffer[words];
+
+    while (true) {
+
+        u64 s1 = seq.load(std::memory_order_acquire);
+        if (s1 == 0) return false;
+        if (s1 & 1) continue;
+
+        for (isize i = 0; i < words; i++) {
+            buffer[i] = data[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq.load(std::memory_order_relaxed) == s1) break;
+    }
+
+    std::memcpy(&snapshot, buffer, sizeof(Snapshot));
+    return true;
+}
+
+}
@@ -0,0 +1,123 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <atomic>
+
+namespace peddle {
+
+// Number of log entries included in a snapshot
+static constexpr isize SNAPSHOT_LOG_ENTRIES = 16;
+
+// A consistent copy of the CPU state
+struct Snapshot {
+
+    // Elapsed clock cycles at the time the snapshot was taken
+    i64 clock;
+
+    // Registers (the snapshot is taken at an instruction boundary)
+    Registers reg;
+
+    // State flags
+    isize flags;
+
+    // Interrupt and ready lines
+    u8 irqLine;
+    u8 nmiLine;
+    u8 rdyLine;
+
+    // The most recent log entries (oldest entry first)
+    isize logCnt;
+    RecordedInstruction log[SNAPSHOT_LOG_ENTRIES];
+};
+
+/* State publisher
+ *
+ * The publisher allows other threads, e.g., a GUI thread, to observe the CPU
+ * state while the emulation thread is running. Accessing the CPU registers
+ * directly from another thread is a data race, and pausing the CPU for each
+ * refresh is costly. Once enabled, the CPU publishes a snapshot at the end of
+ * an instruction whenever the specified number of cycles has elapsed since the
+ * last publication. An interval of 0 publishes after every instruction.
+ *
+ * Snapshots are exchanged via a sequence lock. The emulation thread never
+ * waits. Readers copy the published snapshot and retry if the emulation
+ * thread has modified it in the meantime. The snapshot is stored as an array
+ * of atomic words, which makes the concurrent accesses well-defined.
+ */
+class Publisher {
+
+    friend class Peddle;
+
+    static constexpr isize words = (sizeof(Snapshot) + 7) / 8;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Sequence counter (odd while a snapshot is being written)
+    std::atomic<u64> seq = 0;
+
+    // The published snapshot
+    std::atomic<u64> data[words] = { };
+
+    // Number of cycles between two publications
+    i64 interval = 0;
+
+    // Cycle of the next publication
+    i64 nextPublish = 0;
+
+    // Indicates whether publishing is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Publisher(Peddle& ref) : cpu(ref) { }
+
+    void reset();
+
+
+    //
+    // Controlling (emulation thread)
+    //
+
+public:
+
+    // Turns automatic publishing on or off
+    void enable(i64 cycles = 0);
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Publishes the current state immediately
+    void publish();
+
+private:
+
+    // Called at the end of each instruction or interrupt sequence
+    void recordInstruction(i64 clock) { if (clock >= nextPublish) publish(); }
+
+
+    //
+    // Observing (any thread)
+    //
+
+public:
+
+    // Returns the number of published snapshots
+    u64 version() const { return seq.load(std::memory_order_acquire) / 2; }
+
+    // Copies the most recent snapshot (returns false if none is available)
+    bool read(Snapshot &snapshot) const;
+};
+
+}
@@ -0,0 +1,177 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace peddle {
+
+Sampler::~Sampler()
+{
+    delete [] samples;
+}
+
+void
+Sampler::reset()
+{
+    depth = 0;
+    schedule();
+
+    if (enabled) cpu.flags |= CPU_SAMPLE;
+}
+
+void
+Sampler::setInterval(i64 cycles)
+{
+    if (cycles < 1) throw std::runtime_error("sampling interval must be positive");
+
+    interval = cycles;
+    schedule();
+}
+
+void
+Sampler::setCapacity(isize count)
+{
+    if (count < 1) throw std::runtime_error("sample buffer size must be positive");
+
+    delete [] samples;
+    samples = enabled ? new Sample[count] : nullptr;
+    capacity = count;
+    clear();
+}
+
+void
+Sampler::enable()
+{
+    if (!samples) {
+
+        samples = new Sample[capacity];
+        clear();
+    }
+
+    depth = 0;
+    schedule();
+    enabled = true;
+    cpu.flags |= CPU_SAMPLE;
+}
+
+void
+Sampler::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_SAMPLE;
+}
+
+void
+Sampler::clear()
+{
+    w = 0;
+    fill = 0;
+    taken = 0;
+}
+
+const Sample &
+Sampler::sample(isize nr) const
+{
+    if (nr < 0 || nr >= fill) throw std::runtime_error("sample index out of range");
+
+    return samples[(w - fill + nr + capacity) % capacity];
+}
+
+isize
+Sampler::drain(Sample *buffer, isize max)
+{
+    isize count = std::min(max, fill);
+
+    for (isize i = 0; i < count; i++) buffer[i] = sample(i);
+    fill -= count;
+
+    return count;
+}
+
+void
+Sampler::exportHistogram(std::ostream &os) const
+{
+    std::unordered_map<u32, u64> histogram;
+
+    for (isize i = 0; i < fill; i++) {
+
+        auto &s = sample(i);
+        histogram[u32(s.context) << 16 | s.pc]++;
+    }
+
+    std::vector<std::pair<u32, u64>> sorted(histogram.begin(), histogram.end());
+    std::sort(sorted.begin(), sorted.end(), [](auto &a, auto &b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+
+    for (auto &it : sorted) {
+
+        char line[64];
+        snprintf(line, sizeof(line), "%s %04X %llu\n",
+                 it.first >> 16 == FRAME_IRQ ? "irq" : it.first >> 16 == FRAME_NMI ? "nmi" : "main",
+                 it.first & 0xFFFF, (unsigned long long)it.second);
+        os << line;
+    }
+}
+
+void
+Sampler::enterContext(MicroInstruction last)
+{
+    if (depth < SAMPLE_MAX_CONTEXTS) {
+
+        contexts[depth].type = last == irq_7 ? FRAME_IRQ : FRAME_NMI;
+        contexts[depth].sp = cpu.reg.sp;
+        depth++;
+    }
+}
+
+void
+Sampler::leaveContext()
+{
+    // Leave all interrupt contexts whose stack frame has been pulled
+    while (depth > 0 && i8(cpu.reg.sp - contexts[depth - 1].sp) > 0) depth--;
+}
+
+void
+Sampler::takeSample()
+{
+    auto &s = samples[w];
+
+    s.cycle = u64(cpu.clock);
+    s.pc = cpu.reg.pc0;
+    s.sp = cpu.reg.sp;
+    s.context = u8(depth ? contexts[depth - 1].type : FRAME_ROOT);
+    s.depth = u8(depth);
+
+    for (isize i = 0; i < SAMPLE_STACK_SIZE; i++) {
+        s.stack[i] = cpu.readDasm(u16(0x100 + u8(cpu.reg.sp + 1 + i)));
+    }
+
+    w = (w + 1) % capacity;
+    fill = std::min(fill + 1, capacity);
+    taken++;
+
+    schedule();
+}
+
+void
+Sampler::schedule()
+{
+    // xorshift64
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    nextSample = cpu.clock + interval / 2 + i64(seed % u64(interval));
+}
+
+}
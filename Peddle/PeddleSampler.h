@@ -0,0 +1,178 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include "PeddleCallGraph.h"
+#include <iostream>
+
+namespace peddle {
+
+// Number of stack bytes recorded with each sample
+static constexpr isize SAMPLE_STACK_SIZE = 8;
+
+// Maximum number of nested interrupt contexts tracked by the sampler
+static constexpr isize SAMPLE_MAX_CONTEXTS = 16;
+
+// A single sample
+struct Sample {
+
+    // Clock value
+    u64 cycle;
+
+    // Address of the instruction that has just completed (the address of the
+    // interrupted instruction if an interrupt sequence has just completed)
+    u16 pc;
+
+    // Stack pointer
+    u8 sp;
+
+    // Active interrupt context (FRAME_ROOT, FRAME_IRQ, or FRAME_NMI)
+    u8 context;
+
+    // Interrupt nesting depth
+    u8 depth;
+
+    // Topmost stack bytes, starting at SP + 1
+    u8 stack[SAMPLE_STACK_SIZE];
+};
+
+/* Statistical profiler
+ *
+ * The sampler takes a sample every N cycles. To avoid aliasing with periodic
+ * program behavior, the distance between two samples is jittered uniformly
+ * between N/2 and 3N/2 cycles. Samples are stored in a ring buffer that is
+ * allocated once when sampling is enabled. If the buffer is full, the oldest
+ * sample is overwritten. Between two samples, the CPU only compares the clock
+ * with the next sampling point and keeps track of interrupt entries and exits.
+ */
+class Sampler {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Sample buffer
+    Sample *samples = nullptr;
+    isize capacity = 4096;
+
+    // Write position and number of stored samples
+    isize w = 0;
+    isize fill = 0;
+
+    // Number of samples taken since the last call to clear()
+    u64 taken = 0;
+
+    // Average distance between two samples in cycles
+    i64 interval = 1000;
+
+    // Clock value of the next sample
+    i64 nextSample = 0;
+
+    // Random number generator state (xorshift)
+    u64 seed = 0x9E3779B97F4A7C15;
+
+    // Active interrupt contexts
+    struct { FrameType type; u8 sp; } contexts[SAMPLE_MAX_CONTEXTS];
+    isize depth = 0;
+
+    // Indicates whether sampling is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Sampler(Peddle& ref) : cpu(ref) { }
+    ~Sampler();
+
+    void reset();
+
+
+    //
+    // Configuring
+    //
+
+public:
+
+    // Sets the average distance between two samples
+    void setInterval(i64 cycles);
+    i64 getInterval() const { return interval; }
+
+    // Sets the size of the sample buffer (discards all samples)
+    void setCapacity(isize count);
+    isize getCapacity() const { return capacity; }
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns sampling on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Discards all samples
+    void clear();
+
+
+    //
+    // Analyzing
+    //
+
+public:
+
+    // Returns the number of samples in the buffer
+    isize count() const { return fill; }
+
+    // Returns the number of samples taken, including overwritten ones
+    u64 total() const { return taken; }
+
+    // Returns a sample from the buffer (0 = oldest)
+    const Sample &sample(isize nr) const;
+
+    // Moves up to 'max' samples into a caller-provided buffer
+    isize drain(Sample *buffer, isize max);
+
+    // Exports the number of samples per context and instruction
+    void exportHistogram(std::ostream &os) const;
+
+
+    //
+    // Recording
+    //
+
+private:
+
+    // Called at the end of each instruction or interrupt sequence
+    void recordInstruction(MicroInstruction last, i64 clock) {
+
+        if (last == irq_7 || last == nmi_7 || last == BRK_nmi_6) enterContext(last);
+        if (clock >= nextSample) takeSample();
+        if (last == RTI_5 && depth) leaveContext();
+    }
+
+    // Keeps track of the active interrupt context
+    void enterContext(MicroInstruction last);
+    void leaveContext();
+
+    // Records a sample and schedules the next one
+    void takeSample();
+
+    // Schedules the next sample
+    void schedule();
+};
+
+}
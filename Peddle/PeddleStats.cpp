@@ -0,0 +1,205 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace peddle {
+
+static const char *modeName[] = {
+
+    "implied", "accumulator", "immediate", "zero page", "zero page,x",
+    "zero page,y", "absolute", "absolute,x", "absolute,y", "(indirect,x)",
+    "(indirect),y", "relative", "direct", "indirect"
+};
+
+Statistics::~Statistics()
+{
+    delete [] pairs;
+}
+
+void
+Statistics::reset()
+{
+    if (enabled) cpu.flags |= CPU_COLLECT_STATS;
+}
+
+void
+Statistics::enable()
+{
+    enabled = true;
+    cpu.flags |= CPU_COLLECT_STATS;
+}
+
+void
+Statistics::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_COLLECT_STATS;
+}
+
+void
+Statistics::trackPairs(bool value)
+{
+    if (value && !pairs) {
+
+        pairs = new u64[65536]();
+        follow = u16(cpu.reg.pc0 + 1);
+    }
+    if (!value) {
+
+        delete [] pairs;
+        pairs = nullptr;
+    }
+}
+
+void
+Statistics::clear()
+{
+    counters = { };
+    if (pairs) memset(pairs, 0, 65536 * sizeof(u64));
+}
+
+u64
+Statistics::instructions() const
+{
+    u64 result = 0;
+    for (isize i = 0; i < 256; i++) result += counters.opcodes[i];
+    return result;
+}
+
+u64
+Statistics::instructions(AddressingMode mode) const
+{
+    u64 result = 0;
+    for (isize i = 0; i < 256; i++) {
+        if (cpu.addressingMode[i] == mode) result += counters.opcodes[i];
+    }
+    return result;
+}
+
+void
+Statistics::dump(std::ostream &os) const
+{
+    char line[80];
+    auto total = instructions();
+    auto percent = [&](u64 value) { return total ? 100.0 * double(value) / double(total) : 0.0; };
+
+    auto print = [&](const char *label, u64 value) {
+
+        snprintf(line, sizeof(line), "%-24s %12llu\n", label, (unsigned long long)value);
+        os << line;
+    };
+
+    print("Instructions:", total);
+    print("Page-crossing penalties:", counters.pageCrossings);
+    print("Branches taken:", counters.branchesTaken);
+    print("  crossing a page:", counters.branchPageCrossings);
+    print("Branches not taken:", counters.branchesNotTaken);
+    print("IRQs:", counters.irqs);
+    print("NMIs:", counters.nmis);
+    print("BRKs:", counters.brks);
+
+    // Opcode mix (most frequent first)
+    u8 sorted[256];
+    for (isize i = 0; i < 256; i++) sorted[i] = u8(i);
+    std::stable_sort(sorted, sorted + 256, [&](u8 a, u8 b) {
+        return counters.opcodes[a] > counters.opcodes[b];
+    });
+
+    os << "\nOpcode mix:\n";
+    for (auto opcode : sorted) {
+
+        auto count = counters.opcodes[opcode];
+        if (!count) break;
+
+        snprintf(line, sizeof(line), "  %02X %-4s %-12s %12llu %6.2f%%\n",
+                 opcode, cpu.mnemonic[opcode], modeName[cpu.addressingMode[opcode]],
+                 (unsigned long long)count, percent(count));
+        os << line;
+    }
+
+    os << "\nAddressing modes:\n";
+    for (isize i = 0; i < isize(std::size(modeName)); i++) {
+
+        auto count = instructions(AddressingMode(i));
+        if (!count) continue;
+
+        snprintf(line, sizeof(line), "  %-17s %12llu %6.2f%%\n",
+                 modeName[i], (unsigned long long)count, percent(count));
+        os << line;
+    }
+}
+
+void
+Statistics::recordPair(u16 addr, u8 opcode)
+{
+    if (addr == follow) pairs[counters.opcode << 8 | opcode]++;
+    follow = u16(addr + cpu.getLengthOfInstruction(opcode));
+}
+
+void
+Statistics::recordInstruction(MicroInstruction last, bool crossed)
+{
+    // Interrupt sequences don't fetch an opcode
+    if (last == irq_7) { counters.irqs++; return; }
+    if (last == nmi_7) { counters.nmis++; return; }
+
+    auto addr = cpu.reg.pc0;
+    auto opcode = cpu.readDasm(addr);
+
+    counters.opcodes[opcode]++;
+    if (pairs) recordPair(addr, opcode);
+    counters.opcode = opcode;
+
+    switch (last) {
+
+        case BRK_nmi_6:
+
+            counters.nmis++;
+            return;
+
+        case BRK_6:
+
+            counters.brks++;
+            return;
+
+        case BCC_rel_2: case BCS_rel_2: case BEQ_rel_2: case BMI_rel_2:
+        case BNE_rel_2: case BPL_rel_2: case BVC_rel_2: case BVS_rel_2:
+
+            counters.branchesTaken++;
+            return;
+
+        case branch_3_underflow:
+        case branch_3_overflow:
+
+            counters.branchesTaken++;
+            counters.branchPageCrossings++;
+            return;
+
+        default:
+            break;
+    }
+
+    auto mode = cpu.addressingMode[counters.opcode];
+
+    if (mode == ADDR_RELATIVE) {
+
+        counters.branchesNotTaken++;
+
+    } else if (crossed && cpu.memAccess[counters.opcode] == ACCESS_READ) {
+
+        if (mode == ADDR_ABSOLUTE_X || mode == ADDR_ABSOLUTE_Y || mode == ADDR_INDIRECT_Y) {
+            counters.pageCrossings++;
+        }
+    }
+}
+
+}
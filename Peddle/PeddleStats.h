@@ -0,0 +1,148 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <ostream>
+
+namespace peddle {
+
+// Execution counters
+struct alignas(64) CpuStats {
+
+    // Number of executed instructions per opcode
+    u64 opcodes[256];
+
+    // Number of extra cycles taken by indexed reads crossing a page boundary
+    u64 pageCrossings;
+
+    // Number of taken branches, and taken branches crossing a page boundary
+    u64 branchesTaken;
+    u64 branchPageCrossings;
+
+    // Number of branches not taken
+    u64 branchesNotTaken;
+
+    // Number of interrupt entries (NMIs include hijacked BRK instructions)
+    u64 irqs;
+    u64 nmis;
+    u64 brks;
+
+    // Opcode of the most recently executed instruction
+    u8 opcode;
+};
+
+/* Execution statistics
+ *
+ * The statistics component counts how often each opcode is executed, how
+ * often the CPU takes a penalty cycle, how branches behave, and how often
+ * interrupts are entered. All counters live in a single block that is
+ * updated in place at the end of each instruction, which keeps the fetch
+ * cycle free of any statistics code. Like the instruction log, the component
+ * reads the opcode back via readDasm(). The opcode counter is the only one
+ * touched for most instructions. The remaining counters are derived from the
+ * last microinstruction of each instruction.
+ *
+ * A penalty cycle is counted for read instructions in absolute indexed or
+ * indirect indexed mode if the index addition crosses a page boundary.
+ * Writes and read-modify-write instructions always perform the extra cycle
+ * and are not counted.
+ *
+ * Optionally, the component counts pairs of consecutive instructions. Only
+ * pairs whose second instruction directly follows the first one in memory
+ * are counted, i.e., taken branches, jumps, and interrupts break a pair. The
+ * pair profile is used to select the instruction pairs executed by fused
+ * handlers (see Fusion).
+ */
+class Statistics {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // The counter block
+    CpuStats counters = { };
+
+    // Number of executed instruction pairs (first << 8 | second), if tracked
+    u64 *pairs = nullptr;
+
+    // Address an instruction must have to continue the current pair
+    u16 follow = 0;
+
+    // Indicates whether counting is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Statistics(Peddle& ref) : cpu(ref) { }
+    ~Statistics();
+
+    void reset();
+
+
+    //
+    // Controlling
+    //
+
+public:
+
+    // Turns counting on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Turns the pair profile on or off
+    void trackPairs(bool value);
+    bool isTrackingPairs() const { return pairs != nullptr; }
+
+    // Zeroes all counters
+    void clear();
+
+
+    //
+    // Analyzing
+    //
+
+public:
+
+    // Returns the counter block
+    const CpuStats &get() const { return counters; }
+
+    // Returns the total number of executed instructions
+    u64 instructions() const;
+
+    // Returns the number of executed instructions in a certain addressing mode
+    u64 instructions(AddressingMode mode) const;
+
+    // Returns how often an instruction has been directly followed by another
+    u64 pairCount(u8 first, u8 second) const { return pairs ? pairs[first << 8 | second] : 0; }
+
+    // Prints all counters, the opcode mix, and the addressing-mode histogram
+    void dump(std::ostream &os) const;
+
+
+    //
+    // Recording
+    //
+
+private:
+
+    // Adds an instruction to the pair profile
+    void recordPair(u16 addr, u8 opcode);
+
+    // Called at the end of each instruction or interrupt sequence
+    void recordInstruction(MicroInstruction last, bool crossed);
+};
+
+}
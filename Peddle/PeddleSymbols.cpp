@@ -0,0 +1,151 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "PeddleSymbols.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace peddle {
+
+bool
+SymbolTable::add(u16 addr, const std::string &name)
+{
+    if (map.test(addr)) return false;
+
+    // Keep the load factor below 50%
+    if (2 * (cnt + 1) > isize(slots.size())) grow();
+
+    auto mask = slots.size() - 1;
+    auto i = hash(addr) & mask;
+    while (slots[i].name != empty) i = (i + 1) & mask;
+
+    slots[i] = Slot { addr, u32(pool.size()) };
+    pool.insert(pool.end(), name.begin(), name.end());
+    pool.push_back(0);
+
+    map.set(addr);
+    cnt++;
+    ver++;
+    return true;
+}
+
+void
+SymbolTable::clear()
+{
+    slots.clear();
+    pool.clear();
+    map.clearAll();
+    cnt = 0;
+    ver++;
+}
+
+void
+SymbolTable::grow()
+{
+    std::vector<Slot> old = std::move(slots);
+
+    slots.assign(old.empty() ? 64 : 2 * old.size(), Slot { 0, empty });
+
+    auto mask = slots.size() - 1;
+    for (auto &slot : old) {
+
+        if (slot.name == empty) continue;
+
+        auto i = hash(slot.addr) & mask;
+        while (slots[i].name != empty) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+i32
+SymbolTable::find(const std::string &name) const
+{
+    for (auto &slot : slots) {
+
+        if (slot.name != empty && name == pool.data() + slot.name) return slot.addr;
+    }
+    return -1;
+}
+
+isize
+SymbolTable::load(std::istream &is)
+{
+    isize result = 0;
+    std::string line, name;
+    u16 addr;
+
+    while (std::getline(is, line)) {
+
+        if (parse(line, addr, name) && add(addr, name)) result++;
+    }
+    return result;
+}
+
+isize
+SymbolTable::load(const std::string &path)
+{
+    std::ifstream stream(path);
+    if (!stream) throw std::runtime_error("cannot open " + path);
+
+    return load(stream);
+}
+
+bool
+SymbolTable::parse(const std::string &line, u16 &addr, std::string &name) const
+{
+    // Strip comments
+    auto text = line.substr(0, line.find(';'));
+
+    std::istringstream ss(text);
+    std::string first, second, third;
+    ss >> first >> second >> third;
+
+    auto parseNumber = [&](std::string str, int base) {
+
+        if (str.empty()) return false;
+        if (str[0] == '$') { str = str.substr(1); base = 16; }
+        else if (str.rfind("0x", 0) == 0) { str = str.substr(2); base = 16; }
+
+        try {
+
+            size_t pos;
+            auto value = std::stoul(str, &pos, base);
+            if (pos != str.size() || value > 0xFFFF) return false;
+            addr = u16(value);
+            return true;
+
+        } catch (...) { return false; }
+    };
+
+    if (first == "al") {
+
+        // VICE format: al C:1234 .label
+        if (second.rfind("C:", 0) == 0) second = second.substr(2);
+        if (!third.empty() && third[0] == '.') third = third.substr(1);
+        name = third;
+        return !name.empty() && parseNumber(second, 16);
+    }
+
+    auto eq = text.find('=');
+    if (eq != std::string::npos) {
+
+        // Assignment: label = $1234
+        std::istringstream lhs(text.substr(0, eq)), rhs(text.substr(eq + 1));
+        std::string value;
+        lhs >> name;
+        rhs >> value;
+        if (!name.empty() && name.back() == ':') name.pop_back();
+        return !name.empty() && parseNumber(value, 10);
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,125 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include "PeddleDebuggerTypes.h"
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace peddle {
+
+// Maximum length of a printed label (longer labels are truncated)
+static constexpr isize SYMBOL_MAX_LENGTH = 16;
+
+/* Symbol table
+ *
+ * The symbol table maps addresses to labels. If it is non-empty, the
+ * disassembler prints labels instead of numbers for all operands denoting an
+ * address, i.e., for all operands except immediate values.
+ *
+ * Labels are stored in an open-addressing hash table with linear probing. The
+ * names are kept in a single string pool. An address bitmap rules out
+ * addresses without a label before the hash table is probed. Hence, the lookup
+ * costs a single bit test for most operands.
+ *
+ * Label files are accepted in the following formats:
+ *
+ *     VICE, ld65 -Ln, ACME --vicelabels:   al C:1234 .label
+ *     ACME -l, ca65 / generic assignments: label = $1234
+ *
+ * Lines in other formats, empty lines, and comments are skipped. If an address
+ * has multiple labels, the first one is kept. Labels are stored and looked up
+ * in full, but the disassembler cuts them off after SYMBOL_MAX_LENGTH
+ * characters, which bounds the length of disassembled instructions.
+ */
+class SymbolTable {
+
+    struct Slot {
+
+        u16 addr;
+        u32 name;
+    };
+
+    static constexpr u32 empty = UINT32_MAX;
+
+    // Hash table (the capacity is a power of two)
+    std::vector<Slot> slots;
+
+    // Concatenated, zero-terminated labels
+    std::vector<char> pool;
+
+    // Addresses with a label
+    AddressMap map;
+
+    // Number of stored labels
+    isize cnt = 0;
+
+    // Incremented on each modification
+    isize ver = 0;
+
+
+    //
+    // Managing symbols
+    //
+
+public:
+
+    // Adds a label (returns false if the address already has a label)
+    bool add(u16 addr, const std::string &name);
+
+    // Removes all labels
+    void clear();
+
+    // Returns the number of stored labels
+    isize count() const { return cnt; }
+    bool isEmpty() const { return cnt == 0; }
+
+    // Returns a counter that changes whenever the table is modified
+    isize version() const { return ver; }
+
+    // Returns the label of an address or nullptr
+    const char *lookup(u16 addr) const {
+
+        if (!map.test(addr)) return nullptr;
+
+        auto mask = slots.size() - 1;
+        for (auto i = hash(addr) & mask; ; i = (i + 1) & mask) {
+
+            if (slots[i].name == empty) return nullptr;
+            if (slots[i].addr == addr) return pool.data() + slots[i].name;
+        }
+    }
+
+    // Returns the address of a label or -1
+    i32 find(const std::string &name) const;
+
+
+    //
+    // Loading label files
+    //
+
+public:
+
+    // Loads labels and returns the number of added labels
+    isize load(std::istream &is);
+    isize load(const std::string &path);
+
+private:
+
+    static usize hash(u16 addr) { return usize(addr) * 40503u >> 4; }
+
+    // Doubles the capacity of the hash table
+    void grow();
+
+    // Parses a single line of a label file
+    bool parse(const std::string &line, u16 &addr, std::string &name) const;
+};
+
+}
@@ -0,0 +1,371 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleTrace.h"
+#include "PeddleMacros.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace peddle {
+
+// Size of the encoder's output buffer
+static constexpr isize TRACE_BUFFER_SIZE = 1024 * 1024;
+
+// Maximum size of a single encoded record
+static constexpr isize TRACE_MAX_RECORD_SIZE = 32;
+
+static inline void
+put8(u8 *&p, u8 value)
+{
+    *p++ = value;
+}
+
+static inline void
+put16(u8 *&p, u16 value)
+{
+    *p++ = LO_BYTE(value);
+    *p++ = HI_BYTE(value);
+}
+
+static inline void
+put64(u8 *&p, u64 value)
+{
+    for (isize i = 0; i < 8; i++, value >>= 8) *p++ = u8(value);
+}
+
+static inline void
+putVarint(u8 *&p, u64 value)
+{
+    while (value >= 0x80) { *p++ = u8(value | 0x80); value >>= 7; }
+    *p++ = u8(value);
+}
+
+static inline u64
+get64(const u8 *p)
+{
+    u64 result = 0;
+    for (isize i = 7; i >= 0; i--) result = result << 8 | p[i];
+    return result;
+}
+
+static inline u64
+zigzag(i64 value)
+{
+    return (u64(value) << 1) ^ u64(value >> 63);
+}
+
+static inline i64
+unzigzag(u64 value)
+{
+    return i64(value >> 1) ^ -i64(value & 1);
+}
+
+
+//
+// TraceEncoder
+//
+
+TraceEncoder::TraceEncoder(std::ostream &os, isize blockSize) : os(os), blockSize(blockSize)
+{
+    if (blockSize < 1) throw std::runtime_error("block size must be positive");
+
+    buffer.resize(TRACE_BUFFER_SIZE + TRACE_MAX_RECORD_SIZE);
+    ptr = buffer.data();
+
+    put64(ptr, u64(TRACE_MAGIC) | u64(TRACE_VERSION) << 32);
+}
+
+TraceEncoder::~TraceEncoder()
+{
+    finish();
+}
+
+void
+TraceEncoder::write(const RecordedInstruction &instr)
+{
+    assert(!finished);
+
+    // The seek index requires a monotonic clock
+    if (instr.cycle < prev.cycle) throw std::runtime_error("trace cycles must not decrease");
+
+    // Start a new block periodically
+    if (records % u64(blockSize) == 0) {
+
+        index.push_back(TraceIndexEntry { instr.cycle, records, size() });
+        writeFull(instr);
+
+    } else {
+
+        writeDelta(instr);
+    }
+
+    prev = instr;
+    records++;
+
+    if (ptr - buffer.data() >= TRACE_BUFFER_SIZE) flush();
+}
+
+void
+TraceEncoder::writeFull(const RecordedInstruction &instr)
+{
+    put64(ptr, instr.cycle);
+    put16(ptr, instr.pc);
+    put8(ptr, instr.byte1);
+    put8(ptr, instr.byte2);
+    put8(ptr, instr.byte3);
+    put8(ptr, instr.sp);
+    put8(ptr, instr.a);
+    put8(ptr, instr.x);
+    put8(ptr, instr.y);
+    put8(ptr, instr.flags);
+}
+
+void
+TraceEncoder::writeDelta(const RecordedInstruction &instr)
+{
+    u8 mask =
+    (instr.byte1 != prev.byte1 ? TRACE_BYTE1 : 0) |
+    (instr.byte2 != prev.byte2 ? TRACE_BYTE2 : 0) |
+    (instr.byte3 != prev.byte3 ? TRACE_BYTE3 : 0) |
+    (instr.sp != prev.sp ? TRACE_SP : 0) |
+    (instr.a != prev.a ? TRACE_A : 0) |
+    (instr.x != prev.x ? TRACE_X : 0) |
+    (instr.y != prev.y ? TRACE_Y : 0) |
+    (instr.flags != prev.flags ? TRACE_FLAGS : 0);
+
+    put8(ptr, mask);
+    putVarint(ptr, instr.cycle - prev.cycle);
+    putVarint(ptr, zigzag(i64(instr.pc) - i64(prev.pc)));
+
+    if (mask & TRACE_BYTE1) put8(ptr, instr.byte1);
+    if (mask & TRACE_BYTE2) put8(ptr, instr.byte2);
+    if (mask & TRACE_BYTE3) put8(ptr, instr.byte3);
+    if (mask & TRACE_SP) put8(ptr, instr.sp);
+    if (mask & TRACE_A) put8(ptr, instr.a);
+    if (mask & TRACE_X) put8(ptr, instr.x);
+    if (mask & TRACE_Y) put8(ptr, instr.y);
+    if (mask & TRACE_FLAGS) put8(ptr, instr.flags);
+}
+
+void
+TraceEncoder::finish()
+{
+    if (finished) return;
+
+    u64 indexOffset = size();
+
+    for (auto &entry : index) {
+
+        if (ptr - buffer.data() >= TRACE_BUFFER_SIZE) flush();
+
+        put64(ptr, entry.cycle);
+        put64(ptr, entry.record);
+        put64(ptr, entry.offset);
+    }
+
+    flush();
+
+    put64(ptr, u64(index.size()));
+    put64(ptr, indexOffset);
+    put64(ptr, records);
+    put64(ptr, u64(TRACE_INDEX_MAGIC));
+
+    flush();
+    os.flush();
+    finished = true;
+}
+
+void
+TraceEncoder::flush()
+{
+    auto count = ptr - buffer.data();
+
+    os.write((const char *)buffer.data(), std::streamsize(count));
+    flushed += u64(count);
+    ptr = buffer.data();
+}
+
+
+//
+// TraceDecoder
+//
+
+TraceDecoder::TraceDecoder(const u8 *data, u64 size) : data(data), size(size)
+{
+    init();
+}
+
+TraceDecoder::TraceDecoder(std::istream &is)
+{
+    storage.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    data = storage.data();
+    size = storage.size();
+
+    init();
+}
+
+void
+TraceDecoder::init()
+{
+    if (size < 8 + 32 || u32(get64(data)) != TRACE_MAGIC) {
+        throw std::runtime_error("not a Peddle trace");
+    }
+    if (u16(get64(data) >> 32) != TRACE_VERSION) {
+        throw std::runtime_error("unsupported trace version");
+    }
+
+    // Read the trailer
+    const u8 *trailer = data + size - 32;
+    if (u32(get64(trailer + 24)) != TRACE_INDEX_MAGIC) {
+        throw std::runtime_error("trace is truncated");
+    }
+    u64 blocks = get64(trailer);
+    end = get64(trailer + 8);
+    records = get64(trailer + 16);
+
+    if (end > size - 32 || blocks != (size - 32 - end) / 24) {
+        throw std::runtime_error("trace index is corrupted");
+    }
+
+    // Read the seek index
+    index.resize(blocks);
+    for (u64 i = 0; i < blocks; i++) {
+
+        const u8 *p = data + end + 24 * i;
+        index[i] = TraceIndexEntry { get64(p), get64(p + 8), get64(p + 16) };
+
+        // Blocks must start with consecutive records and ascending cycles
+        if (index[i].record >= records || (i && index[i].record <= index[i - 1].record)) {
+            throw std::runtime_error("trace index is corrupted");
+        }
+        if (i && index[i].cycle < index[i - 1].cycle) {
+            throw std::runtime_error("trace index is corrupted");
+        }
+    }
+
+    // The first block must start with the first record
+    if (records && (blocks == 0 || index[0].record != 0)) {
+        throw std::runtime_error("trace index is corrupted");
+    }
+
+    seekRecord(0);
+}
+
+bool
+TraceDecoder::next(RecordedInstruction &instr)
+{
+    if (nr >= records) return false;
+
+    if (isize(index.size()) > block + 1 && index[block + 1].record == nr) block++;
+
+    if (index[block].record == nr) {
+
+        // Decode a full record
+        pos = index[block].offset;
+        if (pos + 18 > end) throw std::runtime_error("trace is corrupted");
+
+        const u8 *p = data + pos;
+        prev.cycle = get64(p);
+        prev.pc = LO_HI(p[8], p[9]);
+        prev.byte1 = p[10];
+        prev.byte2 = p[11];
+        prev.byte3 = p[12];
+        prev.sp = p[13];
+        prev.a = p[14];
+        prev.x = p[15];
+        prev.y = p[16];
+        prev.flags = p[17];
+        pos += 18;
+
+    } else {
+
+        // Decode a delta record
+        u8 mask = readByte();
+        prev.cycle += readVarint();
+        prev.pc = u16(i64(prev.pc) + unzigzag(readVarint()));
+
+        if (mask & TRACE_BYTE1) prev.byte1 = readByte();
+        if (mask & TRACE_BYTE2) prev.byte2 = readByte();
+        if (mask & TRACE_BYTE3) prev.byte3 = readByte();
+        if (mask & TRACE_SP) prev.sp = readByte();
+        if (mask & TRACE_A) prev.a = readByte();
+        if (mask & TRACE_X) prev.x = readByte();
+        if (mask & TRACE_Y) prev.y = readByte();
+        if (mask & TRACE_FLAGS) prev.flags = readByte();
+    }
+
+    instr = prev;
+    nr++;
+    return true;
+}
+
+void
+TraceDecoder::seek(u64 cycle)
+{
+    // Find the last block starting before the requested cycle
+    auto it = std::lower_bound(index.begin(), index.end(), cycle,
+                               [](const TraceIndexEntry &e, u64 c) { return e.cycle < c; });
+    seekBlock(it == index.begin() ? 0 : isize(it - index.begin()) - 1);
+
+    // Skip all records preceding the requested cycle
+    RecordedInstruction instr;
+    for (u64 mark = nr; next(instr); mark = nr) {
+
+        if (instr.cycle >= cycle) {
+
+            seekBlock(block);
+            while (nr < mark) next(instr);
+            return;
+        }
+    }
+}
+
+void
+TraceDecoder::seekRecord(u64 nr)
+{
+    auto it = std::upper_bound(index.begin(), index.end(), nr,
+                               [](u64 n, const TraceIndexEntry &e) { return n < e.record; });
+    isize target = it == index.begin() ? 0 : isize(it - index.begin()) - 1;
+
+    // Only rewind if the requested record is not ahead in the current block
+    if (target != block || nr < this->nr) seekBlock(target);
+
+    RecordedInstruction instr;
+    while (this->nr < nr && next(instr)) { }
+}
+
+void
+TraceDecoder::seekBlock(isize nr)
+{
+    block = nr;
+    this->nr = index.empty() ? records : index[nr].record;
+    pos = index.empty() ? end : index[nr].offset;
+}
+
+u8
+TraceDecoder::readByte()
+{
+    if (pos >= end) throw std::runtime_error("trace is corrupted");
+    return data[pos++];
+}
+
+u64
+TraceDecoder::readVarint()
+{
+    u64 result = 0;
+
+    for (isize shift = 0; shift < 64; shift += 7) {
+
+        u8 byte = readByte();
+        result |= u64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return result;
+    }
+    throw std::runtime_error("trace is corrupted");
+}
+
+}
@@ -0,0 +1,215 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <iostream>
+#include <vector>
+
+namespace peddle {
+
+/* Compressed trace format
+ *
+ * A trace is a sequence of RecordedInstruction items. Consecutive records
+ * usually differ in very few fields, which is exploited by the encoder. Each
+ * record is stored as a bitmask of changed fields, followed by the cycle and
+ * the program counter as varint deltas and the raw values of all changed
+ * fields. Records are grouped into blocks. The first record of each block is
+ * stored in full, which makes each block decodable on its own. An index at
+ * the end of the file maps each block to its first cycle, its first record
+ * number, and its file offset. Seeking by cycle relies on the cycles being
+ * non-decreasing. Hence, the encoder rejects records with a cycle below the
+ * previous one. A host that resets the clock has to start a new trace.
+ *
+ *     File layout: Header Block Block ... Block Index Trailer
+ *
+ *          Header: "PTRC" (4 bytes), version (u16), reserved (u16)
+ *           Block: Full record, followed by up to n - 1 delta records
+ *     Full record: cycle (u64), pc (u16), byte1-3, sp, a, x, y, flags
+ *    Delta record: mask (u8), cycle delta (varint), pc delta (zigzag varint),
+ *                  changed fields in the order given by the mask bits
+ *           Index: One entry per block: cycle (u64), record (u64), offset (u64)
+ *         Trailer: block count (u64), index offset (u64), record count (u64),
+ *                  "PTRX" (4 bytes)
+ *
+ * All multi-byte values are stored in little-endian byte order.
+ */
+
+static constexpr u32 TRACE_MAGIC = 0x43525450;      // "PTRC"
+static constexpr u32 TRACE_INDEX_MAGIC = 0x58525450; // "PTRX"
+static constexpr u16 TRACE_VERSION = 1;
+
+// Delta record mask bits
+static constexpr u8 TRACE_BYTE1 = 0x01;
+static constexpr u8 TRACE_BYTE2 = 0x02;
+static constexpr u8 TRACE_BYTE3 = 0x04;
+static constexpr u8 TRACE_SP    = 0x08;
+static constexpr u8 TRACE_A     = 0x10;
+static constexpr u8 TRACE_X     = 0x20;
+static constexpr u8 TRACE_Y     = 0x40;
+static constexpr u8 TRACE_FLAGS = 0x80;
+
+// Entry of the seek index
+struct TraceIndexEntry {
+
+    // Cycle of the first record in this block
+    u64 cycle;
+
+    // Number of the first record in this block
+    u64 record;
+
+    // File offset of this block
+    u64 offset;
+};
+
+class TraceEncoder {
+
+    // Output stream
+    std::ostream &os;
+
+    // Number of records per block
+    isize blockSize;
+
+    // Output buffer
+    std::vector<u8> buffer;
+
+    // Write pointer into the output buffer
+    u8 *ptr;
+
+    // Number of bytes that have already been flushed to the output stream
+    u64 flushed = 0;
+
+    // Number of encoded records
+    u64 records = 0;
+
+    // The most recently encoded record
+    RecordedInstruction prev = { };
+
+    // Seek index
+    std::vector<TraceIndexEntry> index;
+
+    // Indicates whether the index and the trailer have been written
+    bool finished = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    TraceEncoder(std::ostream &os, isize blockSize = 4096);
+    ~TraceEncoder();
+
+
+    //
+    // Encoding
+    //
+
+public:
+
+    // Appends a record to the trace
+    void write(const RecordedInstruction &instr);
+    TraceEncoder& operator<<(const RecordedInstruction &instr) { write(instr); return *this; }
+
+    // Writes the seek index and flushes all buffered data
+    void finish();
+
+    // Returns the number of encoded records
+    u64 count() const { return records; }
+
+    // Returns the number of bytes written so far
+    u64 size() const { return flushed + u64(ptr - buffer.data()); }
+
+private:
+
+    void writeFull(const RecordedInstruction &instr);
+    void writeDelta(const RecordedInstruction &instr);
+    void flush();
+};
+
+class TraceDecoder {
+
+    // Trace data (owned if read from a stream)
+    std::vector<u8> storage;
+    const u8 *data;
+    u64 size;
+
+    // Seek index
+    std::vector<TraceIndexEntry> index;
+
+    // Total number of records in the trace
+    u64 records = 0;
+
+    // Offset of the seek index (end of the block area)
+    u64 end = 0;
+
+    // Read pointer
+    u64 pos = 0;
+
+    // Number of the next record to be decoded
+    u64 nr = 0;
+
+    // Block of the next record to be decoded
+    isize block = 0;
+
+    // The most recently decoded record
+    RecordedInstruction prev = { };
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    // Decodes a trace stored in memory (the data is not copied)
+    TraceDecoder(const u8 *data, u64 size);
+
+    // Decodes a trace read from a stream
+    TraceDecoder(std::istream &is);
+
+private:
+
+    void init();
+
+
+    //
+    // Decoding
+    //
+
+public:
+
+    // Returns the number of records in the trace
+    u64 count() const { return records; }
+
+    // Returns the number of the next record to be decoded
+    u64 tell() const { return nr; }
+
+    // Returns the seek index
+    const std::vector<TraceIndexEntry> &getIndex() const { return index; }
+
+    // Decodes the next record (returns false at the end of the trace)
+    bool next(RecordedInstruction &instr);
+
+    // Positions the decoder at the first record with a cycle >= the given one
+    void seek(u64 cycle);
+
+    // Positions the decoder at the record with the given number
+    void seekRecord(u64 nr);
+
+private:
+
+    // Positions the decoder at the beginning of a block
+    void seekBlock(isize nr);
+
+    u8 readByte();
+    u64 readVarint();
+};
+
+}
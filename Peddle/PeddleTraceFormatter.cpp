@@ -0,0 +1,70 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include "PeddleTraceFormatter.h"
+#include <algorithm>
+
+namespace peddle {
+
+TraceFormatter::TraceFormatter(const Disassembler &dasm, std::ostream &os, const char *fmt,
+                               isize capacity) :
+dasm(dasm), os(os), format(Disassembler::compile(fmt)), capacity(std::max(capacity, isize(1)))
+{
+    buffer = new char[this->capacity];
+}
+
+TraceFormatter::~TraceFormatter()
+{
+    flush();
+    delete [] buffer;
+}
+
+void
+TraceFormatter::write(const RecordedInstruction &instr)
+{
+    write(&instr, 1);
+}
+
+void
+TraceFormatter::write(const RecordedInstruction *instr, isize count)
+{
+    // Determine the space needed for a single line (including the newline)
+    auto line = dasm.maxLength(format) + 1;
+
+    // Make sure that the buffer can hold at least one line
+    if (line > capacity) {
+
+        flush();
+        delete [] buffer;
+        buffer = new char[line];
+        capacity = line;
+    }
+
+    for (isize i = 0; i < count; i++) {
+
+        if (capacity - used < line) flush();
+
+        char *p = dasm.writeRecord(buffer + used, format, instr[i]);
+        *p++ = '\n';
+        used = p - buffer;
+    }
+}
+
+void
+TraceFormatter::flush()
+{
+    if (used) {
+
+        os.write(buffer, used);
+        used = 0;
+    }
+    os.flush();
+}
+
+}
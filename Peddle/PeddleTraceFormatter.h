@@ -0,0 +1,59 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleDisassembler.h"
+#include <ostream>
+
+namespace peddle {
+
+/* Trace formatter
+ *
+ * The formatter converts recorded instructions into text, one line per
+ * record. The format string is compiled once and accepts the same control
+ * sequences as Disassembler::disass(). The lines are rendered directly into
+ * a large output buffer, which is handed over to the stream in a single
+ * write call whenever it is full. Hence, large traces are written with one
+ * system call per buffer instead of one or more per line. The buffer is
+ * flushed whenever the remaining space falls below the longest line the
+ * format can produce in the disassembler's current styles.
+ *
+ * The remaining text is written when the formatter is flushed or destroyed.
+ */
+class TraceFormatter {
+
+    // The disassembler rendering the records
+    const Disassembler &dasm;
+
+    // The output stream
+    std::ostream &os;
+
+    // The compiled format string
+    DasmFormat format;
+
+    // The output buffer
+    char *buffer = nullptr;
+    isize capacity;
+    isize used = 0;
+
+public:
+
+    TraceFormatter(const Disassembler &dasm, std::ostream &os, const char *fmt,
+                   isize capacity = 1024 * 1024);
+    ~TraceFormatter();
+
+    // Renders a single record or a batch of records
+    void write(const RecordedInstruction &instr);
+    void write(const RecordedInstruction *instr, isize count);
+    TraceFormatter& operator<<(const RecordedInstruction &instr) { write(instr); return *this; }
+
+    // Writes the buffered text to the stream
+    void flush();
+};
+
+}
@@ -0,0 +1,331 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleTraceIndex.h"
+#include "Peddle.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace peddle {
+
+// Size of the file header in u64 words
+static constexpr isize INDEX_HEADER_WORDS = 9;
+
+// Number of entries in each offset table
+static constexpr isize INDEX_KEYS = 65537;
+
+TraceIndex::TraceIndex(TraceDecoder &trace) : trace(trace)
+{
+    if (trace.count() > UINT32_MAX) {
+        throw std::runtime_error("trace is too large to be indexed");
+    }
+
+    storage.assign(INDEX_HEADER_WORDS + 3 * INDEX_KEYS, 0);
+    u64 *e = storage.data() + INDEX_HEADER_WORDS;
+    u64 *r = e + INDEX_KEYS;
+    u64 *w = r + INDEX_KEYS;
+    u64 spCnt = 0;
+
+    RecordedInstruction instr;
+    u8 sp = 0;
+
+    // Pass 1: Count the number of entries per key
+    trace.seekRecord(0);
+    for (u64 nr = 0; trace.next(instr); nr++) {
+
+        e[instr.pc + 1]++;
+        forEachAccess(instr, [&](u16 addr, MemAccess access) {
+
+            if (access & ACCESS_READ) r[addr + 1]++;
+            if (access & ACCESS_WRITE) w[addr + 1]++;
+        });
+
+        if (nr && instr.sp != sp) spCnt++;
+        sp = instr.sp;
+    }
+
+    // Turn the counters into offsets
+    for (isize i = 1; i < INDEX_KEYS; i++) {
+
+        e[i] += e[i - 1];
+        r[i] += r[i - 1];
+        w[i] += w[i - 1];
+    }
+
+    // Allocate the posting lists
+    writeHeader(e[INDEX_KEYS - 1], r[INDEX_KEYS - 1], w[INDEX_KEYS - 1], spCnt);
+    storage.resize(INDEX_HEADER_WORDS + 3 * INDEX_KEYS + (storage[5] + storage[6] + storage[7] + spCnt + 1) / 2);
+    data = storage.data();
+    size = storage.size() * 8;
+    locate();
+
+    // Pass 2: Fill the posting lists
+    std::vector<u64> ep(execs.offsets, execs.offsets + INDEX_KEYS - 1);
+    std::vector<u64> rp(reads.offsets, reads.offsets + INDEX_KEYS - 1);
+    std::vector<u64> wp(writes.offsets, writes.offsets + INDEX_KEYS - 1);
+    u32 *spp = spChanges;
+
+    trace.seekRecord(0);
+    for (u32 nr = 0; trace.next(instr); nr++) {
+
+        execs.records[ep[instr.pc]++] = nr;
+        forEachAccess(instr, [&](u16 addr, MemAccess access) {
+
+            if (access & ACCESS_READ) reads.records[rp[addr]++] = nr;
+            if (access & ACCESS_WRITE) writes.records[wp[addr]++] = nr;
+        });
+
+        if (nr && instr.sp != sp) *spp++ = nr;
+        sp = instr.sp;
+    }
+}
+
+TraceIndex::TraceIndex(TraceDecoder &trace, const std::string &path) : trace(trace)
+{
+#ifndef _WIN32
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+
+        size = u64(st.st_size);
+        mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) mapping = nullptr;
+    }
+    close(fd);
+
+    if (mapping) {
+
+        data = (u64 *)mapping;
+        if (!locate()) {
+
+            munmap(mapping, size);
+            throw std::runtime_error(path + " is not an index of this trace");
+        }
+        return;
+    }
+
+#endif
+
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream) throw std::runtime_error("cannot open " + path);
+
+    size = u64(stream.tellg());
+    storage.resize((size + 7) / 8);
+    stream.seekg(0);
+    stream.read((char *)storage.data(), std::streamsize(size));
+
+    data = storage.data();
+    if (!stream || !locate()) throw std::runtime_error(path + " is not an index of this trace");
+}
+
+TraceIndex::~TraceIndex()
+{
+#ifndef _WIN32
+    if (mapping) munmap(mapping, size);
+#endif
+}
+
+void
+TraceIndex::save(std::ostream &os) const
+{
+    os.write((const char *)data, std::streamsize(size));
+    if (!os) throw std::runtime_error("cannot write the index");
+}
+
+void
+TraceIndex::writeHeader(u64 execCount, u64 readCount, u64 writeCount, u64 spCount)
+{
+    auto &blocks = trace.getIndex();
+
+    storage[0] = u64(INDEX_MAGIC) | u64(INDEX_VERSION) << 32;
+    storage[1] = trace.count();
+    storage[2] = blocks.size();
+    storage[3] = blocks.empty() ? 0 : blocks.back().cycle;
+    storage[4] = blocks.empty() ? 0 : blocks.back().offset;
+    storage[5] = execCount;
+    storage[6] = readCount;
+    storage[7] = writeCount;
+    storage[8] = spCount;
+}
+
+bool
+TraceIndex::locate()
+{
+    auto &blocks = trace.getIndex();
+
+    if (size < INDEX_HEADER_WORDS * 8 || size % 8) return false;
+
+    // Check the header
+    if (data[0] != (u64(INDEX_MAGIC) | u64(INDEX_VERSION) << 32) ||
+        data[1] != trace.count() ||
+        data[2] != blocks.size() ||
+        data[3] != (blocks.empty() ? 0 : blocks.back().cycle) ||
+        data[4] != (blocks.empty() ? 0 : blocks.back().offset)) return false;
+
+    // Check the size (each list holds at most four entries per record)
+    u64 limit = 4 * trace.count();
+    if (data[5] > limit || data[6] > limit || data[7] > limit || data[8] > limit) return false;
+
+    u64 entries = data[5] + data[6] + data[7] + data[8];
+    if (size != 8 * (INDEX_HEADER_WORDS + 3 * INDEX_KEYS + (entries + 1) / 2)) return false;
+
+    execs.offsets = data + INDEX_HEADER_WORDS;
+    reads.offsets = execs.offsets + INDEX_KEYS;
+    writes.offsets = reads.offsets + INDEX_KEYS;
+    execs.records = (u32 *)(writes.offsets + INDEX_KEYS);
+    reads.records = execs.records + data[5];
+    writes.records = reads.records + data[6];
+    spChanges = writes.records + data[7];
+    spCount = data[8];
+
+    // Check the offset tables
+    for (auto lists : { &execs, &reads, &writes }) {
+
+        if (lists->offsets[0] != 0) return false;
+        for (isize i = 1; i < INDEX_KEYS; i++) {
+            if (lists->offsets[i] < lists->offsets[i - 1]) return false;
+        }
+    }
+    return
+    execs.offsets[INDEX_KEYS - 1] == data[5] &&
+    reads.offsets[INDEX_KEYS - 1] == data[6] &&
+    writes.offsets[INDEX_KEYS - 1] == data[7];
+}
+
+template <class F> void
+TraceIndex::forEachAccess(const RecordedInstruction &instr, F func)
+{
+    auto stack = [&](isize offset) { return u16(0x100 | U8_ADD(instr.sp, offset)); };
+    auto word = LO_HI(instr.byte2, instr.byte3);
+    auto access = Peddle::memAccess[instr.byte1];
+
+    switch (instr.byte1) {
+
+        case 0x00: // BRK
+
+            for (isize i = 1; i <= 3; i++) func(stack(i), ACCESS_WRITE);
+            return;
+
+        case 0x20: // JSR
+
+            for (isize i = 1; i <= 2; i++) func(stack(i), ACCESS_WRITE);
+            return;
+
+        case 0x08: // PHP
+        case 0x48: // PHA
+
+            func(stack(1), ACCESS_WRITE);
+            return;
+
+        case 0x28: // PLP
+        case 0x68: // PLA
+
+            func(stack(0), ACCESS_READ);
+            return;
+
+        case 0x60: // RTS
+
+            for (isize i = -1; i <= 0; i++) func(stack(i), ACCESS_READ);
+            return;
+
+        case 0x40: // RTI
+
+            for (isize i = -2; i <= 0; i++) func(stack(i), ACCESS_READ);
+            return;
+    }
+
+    if (access == ACCESS_NONE) return;
+
+    switch (Peddle::addressingMode[instr.byte1]) {
+
+        case ADDR_ZERO_PAGE:    func(instr.byte2, access); break;
+        case ADDR_ZERO_PAGE_X:  func(U8_ADD(instr.byte2, instr.x), access); break;
+        case ADDR_ZERO_PAGE_Y:  func(U8_ADD(instr.byte2, instr.y), access); break;
+        case ADDR_ABSOLUTE:     func(word, access); break;
+        case ADDR_ABSOLUTE_X:   func(U16_ADD(word, instr.x), access); break;
+        case ADDR_ABSOLUTE_Y:   func(U16_ADD(word, instr.y), access); break;
+
+        case ADDR_INDIRECT:
+
+            // JMP ($xxFF) fetches the high byte from $xx00
+            func(word, access);
+            func(u16((word & 0xFF00) | U8_ADD(word, 1)), access);
+            break;
+
+        default:
+            break;
+    }
+}
+
+u64
+TraceIndex::recordAt(u64 cycle)
+{
+    trace.seek(cycle);
+    return trace.tell();
+}
+
+RecordedInstruction
+TraceIndex::record(u64 nr)
+{
+    RecordedInstruction result = { };
+
+    trace.seekRecord(nr);
+    trace.next(result);
+    return result;
+}
+
+std::span<const u32>
+TraceIndex::executions(u16 pc, u64 from, u64 to)
+{
+    return select(execs[pc], from, to);
+}
+
+std::span<const u32>
+TraceIndex::readsFrom(u16 addr, u64 from, u64 to)
+{
+    return select(reads[addr], from, to);
+}
+
+std::span<const u32>
+TraceIndex::writesTo(u16 addr, u64 from, u64 to)
+{
+    return select(writes[addr], from, to);
+}
+
+i64
+TraceIndex::lastSPChange(u64 cycle)
+{
+    u64 end = cycle == UINT64_MAX ? trace.count() : recordAt(cycle + 1);
+
+    auto it = std::lower_bound(spChanges, spChanges + spCount, end);
+    return it == spChanges ? -1 : i64(*(it - 1));
+}
+
+std::span<const u32>
+TraceIndex::select(std::span<const u32> list, u64 from, u64 to)
+{
+    u64 first = from ? recordAt(from) : 0;
+    u64 last = to == UINT64_MAX ? trace.count() : recordAt(to + 1);
+
+    auto lo = std::lower_bound(list.begin(), list.end(), first);
+    auto hi = std::lower_bound(lo, list.end(), last);
+
+    return { lo, hi };
+}
+
+}
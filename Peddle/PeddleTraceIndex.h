@@ -0,0 +1,153 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTrace.h"
+#include <span>
+#include <string>
+
+namespace peddle {
+
+/* Trace index
+ *
+ * The index is built in an offline pass over a recorded trace. It stores
+ * posting lists, i.e., sorted lists of record numbers, for each executed
+ * program counter, for each read or written memory address, and for all
+ * instructions that changed the stack pointer. All lists are kept in
+ * compressed sparse row format: An offset table with one entry per key points
+ * into a single array holding the record numbers of all keys.
+ *
+ * Memory addresses are reconstructed from the recorded instruction bytes and
+ * registers. This works for all direct, indexed and stack addressing modes.
+ * Accesses through zero-page pointers ((zp,X) and (zp),Y) cannot be resolved,
+ * because the trace does not record memory contents. They are not indexed.
+ *
+ * Cycle ranges are translated into record ranges with the seek index of the
+ * underlying trace, which makes each query a handful of binary searches.
+ *
+ * Building the index requires two passes over the trace. To avoid this for
+ * each query, the index can be saved to a file and loaded later. The file is
+ * mapped into memory, and the posting lists are used in place. The header
+ * identifies the trace by its record count and its seek index, so an index
+ * isn't loaded for a different trace.
+ *
+ *     File layout: Header Offsets Records
+ *
+ *          Header: "PIDX" (4 bytes), version (u16), reserved (u16), record
+ *                  count, block count, first cycle and offset of the last
+ *                  block of the trace (u64 each), number of exec, read,
+ *                  write, and SP change entries (u64 each)
+ *         Offsets: Offset tables of the exec, read, and write lists
+ *                  (u64[65537] each)
+ *         Records: Exec, read, write, and SP change entries (u32[] each),
+ *                  padded to a multiple of 8 bytes
+ *
+ * All multi-byte values are stored in little-endian byte order.
+ */
+
+static constexpr u32 INDEX_MAGIC = 0x58444950;       // "PIDX"
+static constexpr u16 INDEX_VERSION = 1;
+
+class TraceIndex {
+
+    // Posting lists in compressed sparse row format
+    struct PostingLists {
+
+        u64 *offsets = nullptr;
+        u32 *records = nullptr;
+
+        std::span<const u32> operator[](isize key) const {
+            return { records + offsets[key], records + offsets[key + 1] };
+        }
+    };
+
+    // The indexed trace
+    TraceDecoder &trace;
+
+    // Index data in file format (mapped or owned)
+    u64 *data = nullptr;
+    u64 size = 0;
+    std::vector<u64> storage;
+    void *mapping = nullptr;
+
+    // Records grouped by the executed program counter
+    PostingLists execs;
+
+    // Records grouped by the accessed memory address
+    PostingLists reads;
+    PostingLists writes;
+
+    // Records of all instructions that modified the stack pointer
+    u32 *spChanges = nullptr;
+    u64 spCount = 0;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    // Builds the index
+    TraceIndex(TraceDecoder &trace);
+
+    // Loads an index file (or reads it if mapping is unavailable)
+    TraceIndex(TraceDecoder &trace, const std::string &path);
+
+    ~TraceIndex();
+
+    TraceIndex(const TraceIndex &) = delete;
+    TraceIndex& operator=(const TraceIndex &) = delete;
+
+    // Returns the default location of the index file of a trace file
+    static std::string pathFor(const std::string &tracePath) { return tracePath + ".idx"; }
+
+    // Saves the index
+    void save(std::ostream &os) const;
+
+private:
+
+    // Calls a function for each memory access performed by an instruction
+    template <class F> static void forEachAccess(const RecordedInstruction &instr, F func);
+
+    // Writes the file header for the indexed trace
+    void writeHeader(u64 execCount, u64 readCount, u64 writeCount, u64 spCount);
+
+    // Sets up the pointers into the index data (returns false if the header doesn't match)
+    bool locate();
+
+
+    //
+    // Querying
+    //
+
+public:
+
+    // Returns the number of the first record with a cycle >= the given one
+    u64 recordAt(u64 cycle);
+
+    // Returns a single record
+    RecordedInstruction record(u64 nr);
+
+    // Returns all records executing the given instruction in a cycle range
+    std::span<const u32> executions(u16 pc, u64 from = 0, u64 to = UINT64_MAX);
+
+    // Returns all records accessing the given address in a cycle range
+    std::span<const u32> readsFrom(u16 addr, u64 from = 0, u64 to = UINT64_MAX);
+    std::span<const u32> writesTo(u16 addr, u64 from = 0, u64 to = UINT64_MAX);
+
+    // Returns the last record at or before a cycle that changed SP (or -1)
+    i64 lastSPChange(u64 cycle);
+
+private:
+
+    // Restricts a posting list to a cycle range
+    std::span<const u32> select(std::span<const u32> list, u64 from, u64 to);
+};
+
+}
@@ -0,0 +1,70 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+
+namespace peddle {
+
+void
+Traps::reset()
+{
+    update();
+}
+
+void
+Traps::set(u16 addr, isize id)
+{
+    map.set(addr);
+    ids[addr] = id;
+    update();
+}
+
+void
+Traps::remove(u16 addr)
+{
+    map.clear(addr);
+    ids.erase(addr);
+    update();
+}
+
+void
+Traps::clear()
+{
+    map.clearAll();
+    ids.clear();
+    update();
+}
+
+isize
+Traps::id(u16 addr) const
+{
+    auto it = ids.find(addr);
+    return it != ids.end() ? it->second : -1;
+}
+
+u16
+Traps::returnAddress()
+{
+    u8 lo = cpu.readDasm(u16(0x100 + u8(cpu.reg.sp + 1)));
+    u8 hi = cpu.readDasm(u16(0x100 + u8(cpu.reg.sp + 2)));
+    cpu.reg.sp += 2;
+
+    return u16(LO_HI(lo, hi) + 1);
+}
+
+void
+Traps::update()
+{
+    if (ids.empty()) {
+        cpu.flags &= ~CPU_CHECK_TRAP;
+    } else {
+        cpu.flags |= CPU_CHECK_TRAP;
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include "PeddleDebuggerTypes.h"
+#include <unordered_map>
+
+namespace peddle {
+
+/* PC traps
+ *
+ * A trap replaces the code at a certain address by a native handler, e.g.,
+ * to load a file without emulating the serial bus, or to run a floating-point
+ * routine of the BASIC ROM natively. When an instruction or interrupt
+ * sequence completes and the next instruction starts at a trapped address,
+ * the CPU calls trapReached() instead of fetching the instruction. The host
+ * handles the trap by overriding this delegate. It may modify the registers,
+ * the memory, and the clock, and returns the address to continue at. If it
+ * returns the trapped address itself, the original code is executed.
+ *
+ * The CPU resumes at the returned address without checking it for a trap, so
+ * a trap never fires twice in a row. Breakpoints are checked at the resume
+ * address. The undo journal treats the handler as part of the preceding
+ * instruction. To make its memory writes revertible, the handler has to call
+ * Journal::recordWrite() prior to each write.
+ *
+ * Trapped addresses are stored in an address map. Each trap carries an
+ * identifier that is passed to the handler. The CPU only looks at the map
+ * while at least one trap is set.
+ */
+class Traps {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Trapped addresses
+    AddressMap map;
+
+    // Trap identifiers
+    std::unordered_map<u16, isize> ids;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    Traps(Peddle& ref) : cpu(ref) { }
+
+    void reset();
+
+
+    //
+    // Managing traps
+    //
+
+public:
+
+    // Sets a trap (replaces an existing trap at the same address)
+    void set(u16 addr, isize id = 0);
+
+    // Removes a trap
+    void remove(u16 addr);
+
+    // Removes all traps
+    void clear();
+
+    // Returns the number of traps
+    isize count() const { return isize(ids.size()); }
+
+    // Checks whether an address is trapped
+    bool isSet(u16 addr) const { return map.test(addr); }
+
+    // Returns the identifier of a trap (-1 if the address is not trapped)
+    isize id(u16 addr) const;
+
+
+    //
+    // Supporting handlers
+    //
+
+public:
+
+    // Pulls a return address from the stack the way RTS does (reads with readDasm())
+    u16 returnAddress();
+
+private:
+
+    // Updates the state flag
+    void update();
+};
+
+}
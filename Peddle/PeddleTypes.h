@@ -119,12 +119,95 @@ typedef u8 IntSource;
  *
  *    These flags indicate whether the CPU should check for breakpoints,
  *    watchpoints, or catchpoints.
+ *
+ * CPU_PROFILE:
+ *
+ *    This flag is set if the flat execution profiler is enabled. If set, the
+ *    CPU updates the per-instruction counters at the end of each instruction.
+ *
+ * CPU_PROFILE_CALLS:
+ *
+ *    This flag is set if the call graph profiler is enabled. If set, the CPU
+ *    reports all JSR, RTS, RTI, BRK, and interrupt sequences to the profiler.
+ *
+ * CPU_SAMPLE:
+ *
+ *    This flag is set if the statistical profiler is enabled. If set, the CPU
+ *    checks at the end of each instruction whether a sample is due.
+ *
+ * CPU_TRACK_COVERAGE:
+ *
+ *    This flag is set if coverage tracking is enabled. If set, the memory
+ *    interface records each fetch, read, and write in the coverage map.
+ *
+ * CPU_JOURNAL:
+ *
+ *    This flag is set if the undo journal is enabled. If set, the CPU saves
+ *    the overwritten value of each memory write and the register state at
+ *    the end of each instruction.
+ *
+ * CPU_CHECK_TRIGGER:
+ *
+ *    This flag is set if trace triggers are armed. If set, the CPU evaluates
+ *    the triggers at the end of each instruction, prior to logging it.
+ *
+ * CPU_PUBLISH_STATE:
+ *
+ *    This flag is set if the state publisher is enabled. If set, the CPU
+ *    publishes a snapshot of its state for other threads at the end of an
+ *    instruction once the publishing interval has elapsed.
+ *
+ * CPU_PROCESS_COMMANDS:
+ *
+ *    This flag is set if the command queue is enabled. If set, the CPU
+ *    executes all commands issued by other threads at the end of each
+ *    instruction, prior to checking for breakpoints.
+ *
+ * CPU_TRACK_XREFS:
+ *
+ *    This flag is set if dynamic cross-reference collection is enabled. If
+ *    set, the memory interface records each read and write together with the
+ *    accessing instruction, and the CPU records taken branches, jumps, and
+ *    subroutine calls at the end of each instruction.
+ *
+ * CPU_TRACK_BOUNDARIES:
+ *
+ *    This flag is set if the instruction-boundary index tracks writes. If
+ *    set, the memory interface informs the index about each write, which
+ *    invalidates the decoding of the affected pages.
+ *
+ * CPU_COLLECT_STATS:
+ *
+ *    This flag is set if execution statistics are collected. If set, the CPU
+ *    counts and classifies each completed instruction.
+ *
+ * CPU_CHECK_TRAP:
+ *
+ *    This flag is set if at least one PC trap is set. If set, the CPU checks
+ *    the address of each instruction against the trap table before fetching
+ *    it.
  */
 #ifdef __cplusplus
 static constexpr int CPU_LOG_INSTRUCTION    = (1 << 0);
 static constexpr int CPU_CHECK_BP           = (1 << 1);
 static constexpr int CPU_CHECK_WP           = (1 << 2);
 static constexpr int CPU_CHECK_CP           = (1 << 3);
+static constexpr int CPU_PROFILE            = (1 << 4);
+static constexpr int CPU_PROFILE_CALLS      = (1 << 5);
+static constexpr int CPU_SAMPLE             = (1 << 6);
+static constexpr int CPU_TRACK_COVERAGE     = (1 << 7);
+static constexpr int CPU_JOURNAL            = (1 << 8);
+static constexpr int CPU_CHECK_TRIGGER      = (1 << 9);
+static constexpr int CPU_PUBLISH_STATE      = (1 << 10);
+static constexpr int CPU_PROCESS_COMMANDS   = (1 << 11);
+static constexpr int CPU_TRACK_XREFS        = (1 << 12);
+static constexpr int CPU_TRACK_BOUNDARIES   = (1 << 13);
+static constexpr int CPU_COLLECT_STATS      = (1 << 14);
+static constexpr int CPU_CHECK_TRAP         = (1 << 15);
+
+// Flags evaluated by the memory interface (in addition to CPU_CHECK_WP)
+static constexpr int CPU_MEMORY_HOOKS =
+CPU_TRACK_COVERAGE | CPU_JOURNAL | CPU_TRACK_XREFS | CPU_TRACK_BOUNDARIES;
 #endif
 
 
@@ -160,6 +243,15 @@ peddle_enum_long(ADDR_MODE)
 };
 typedef ADDR_MODE AddressingMode;
 
+peddle_enum_long(MEM_ACCESS)
+{
+    ACCESS_NONE     = 0,
+    ACCESS_READ     = 1,
+    ACCESS_WRITE    = 2,
+    ACCESS_MODIFY   = 3     // Read-modify-write
+};
+typedef MEM_ACCESS MemAccess;
+
 peddle_enum_long(MICRO_INSTRUCTION) {
 
     fetch,
@@ -536,6 +628,17 @@ typedef struct
 }
 DasmStyle;
 
+typedef struct
+{
+    u16 addr;               // Address of the instruction
+    u8 length;              // Length of the instruction in bytes
+    u8 bytes[3];            // Instruction bytes
+    char address[10];       // Formatted address
+    char data[16];          // Formatted instruction bytes
+    char instr[32];         // Disassembled instruction
+}
+DasmRecord;
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,6 +8,8 @@
 #pragma once
 
 #include "PeddleMacros.h"
+#include <atomic>
+#include <utility>
 
 namespace peddle {
 
@@ -121,4 +123,132 @@ public:
     }
 };
 
+/* Single-producer, single-consumer queue
+ *
+ * The queue connects exactly two threads without using locks. One thread
+ * calls push(), the other one calls pop(). Both indices only grow and are
+ * stored in separate cache lines to avoid false sharing.
+ */
+template <class T, isize capacity> class SPSCQueue {
+
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+    // Queue elements
+    T elements[capacity];
+
+    // Read and write index
+    alignas(64) std::atomic<u64> r = 0;
+    alignas(64) std::atomic<u64> w = 0;
+
+public:
+
+    // Checks whether the queue is empty (may be called by both threads)
+    bool isEmpty() const { return r.load(std::memory_order_acquire) == w.load(std::memory_order_acquire); }
+
+    // Appends an element (producer side)
+    bool push(T &&value) {
+
+        auto pos = w.load(std::memory_order_relaxed);
+        if (pos - r.load(std::memory_order_acquire) == capacity) return false;
+
+        elements[pos & (capacity - 1)] = std::move(value);
+        w.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Removes the oldest element (consumer side)
+    bool pop(T &value) {
+
+        auto pos = r.load(std::memory_order_relaxed);
+        if (pos == w.load(std::memory_order_acquire)) return false;
+
+        value = std::move(elements[pos & (capacity - 1)]);
+        r.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+/* Multi-producer, single-consumer queue
+ *
+ * The queue is a bounded ring buffer in which each slot carries a sequence
+ * number. An arbitrary number of threads may call push(), but only a single
+ * thread may call pop(). Producers reserve a slot by advancing the write index
+ * with a compare-and-swap and publish the element by updating the slot's
+ * sequence number. Hence, a producer never waits for another one.
+ */
+template <class T, isize capacity> class MPSCQueue {
+
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+    struct Slot {
+
+        std::atomic<u64> seq;
+        T value;
+    };
+
+    // Queue elements
+    Slot slots[capacity];
+
+    // Write index (shared by all producers)
+    alignas(64) std::atomic<u64> w = 0;
+
+    // Read index (owned by the consumer)
+    alignas(64) u64 r = 0;
+
+public:
+
+    MPSCQueue() {
+
+        for (isize i = 0; i < capacity; i++) slots[i].seq.store(u64(i), std::memory_order_relaxed);
+    }
+
+    // Checks whether the queue is empty (consumer side)
+    bool isEmpty() const {
+
+        return slots[r & (capacity - 1)].seq.load(std::memory_order_acquire) != r + 1;
+    }
+
+    // Appends an element (producer side)
+    bool push(const T &value) {
+
+        auto pos = w.load(std::memory_order_relaxed);
+
+        while (true) {
+
+            auto &slot = slots[pos & (capacity - 1)];
+            auto diff = i64(slot.seq.load(std::memory_order_acquire) - pos);
+
+            if (diff == 0) {
+
+                if (w.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+
+                    slot.value = value;
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+
+            } else if (diff < 0) {
+
+                return false;
+
+            } else {
+
+                pos = w.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Removes the oldest element (consumer side)
+    bool pop(T &value) {
+
+        auto &slot = slots[r & (capacity - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != r + 1) return false;
+
+        value = std::move(slot.value);
+        slot.seq.store(r + capacity, std::memory_order_release);
+        r++;
+        return true;
+    }
+};
+
 }
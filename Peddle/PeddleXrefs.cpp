@@ -0,0 +1,210 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "PeddleConfig.h"
+#include "Peddle.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace peddle {
+
+CrossReferences::~CrossReferences()
+{
+    delete [] recent;
+}
+
+void
+CrossReferences::reset()
+{
+    if (enabled) cpu.flags |= CPU_TRACK_XREFS;
+}
+
+void
+CrossReferences::enable()
+{
+    if (!recent) {
+
+        recent = new u64[recentSize];
+        std::fill(recent, recent + recentSize, UINT64_MAX);
+    }
+
+    enabled = true;
+    cpu.flags |= CPU_TRACK_XREFS;
+}
+
+void
+CrossReferences::disable()
+{
+    enabled = false;
+    cpu.flags &= ~CPU_TRACK_XREFS;
+}
+
+void
+CrossReferences::clear()
+{
+    edges.clear();
+    offsets.clear();
+    refs.clear();
+    if (recent) std::fill(recent, recent + recentSize, UINT64_MAX);
+}
+
+void
+CrossReferences::collectStatic()
+{
+    auto &analyzer = cpu.analyzer;
+    if (analyzer.getBlocks().empty()) analyzer.analyze();
+
+    for (isize i = 0; i < 65536; i++) {
+
+        if (!(analyzer.get(u16(i)) & ANALYSIS_OPCODE)) continue;
+
+        u16 pc = u16(i);
+        u8 opcode = cpu.readDasm(pc);
+        u16 operand = LO_HI(cpu.readDasm(u16(pc + 1)), cpu.readDasm(u16(pc + 2)));
+        u8 kind = 0;
+
+        switch (cpu.memAccess[opcode]) {
+
+            case ACCESS_READ:   kind = XREF_READ; break;
+            case ACCESS_WRITE:  kind = XREF_WRITE; break;
+            case ACCESS_MODIFY: kind = XREF_READ | XREF_WRITE; break;
+
+            default:
+                break;
+        }
+
+        auto add = [&](u16 target, u8 kind) {
+            edges.push_back(u64(target) << 24 | u64(pc) << 8 | kind);
+        };
+
+        switch (cpu.addressingMode[opcode]) {
+
+            case ADDR_ZERO_PAGE:
+            case ADDR_ZERO_PAGE_X:
+            case ADDR_ZERO_PAGE_Y:
+
+                if (kind) add(u8(operand), kind);
+                break;
+
+            case ADDR_ABSOLUTE:
+            case ADDR_ABSOLUTE_X:
+            case ADDR_ABSOLUTE_Y:
+
+                if (kind) add(operand, kind);
+                break;
+
+            case ADDR_INDIRECT_X:
+            case ADDR_INDIRECT_Y:
+
+                // The effective address is unknown. Record the pointer instead.
+                add(u8(operand), XREF_READ);
+                break;
+
+            case ADDR_DIRECT:
+
+                add(operand, opcode == 0x20 ? XREF_CALL : XREF_JUMP);
+                break;
+
+            case ADDR_INDIRECT:
+
+                add(operand, XREF_READ);
+                break;
+
+            case ADDR_RELATIVE:
+
+                add(u16(pc + 2 + (i8)u8(operand)), XREF_BRANCH);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void
+CrossReferences::recordInstruction(MicroInstruction last, u16 pc0, u16 pc)
+{
+    switch (last) {
+
+        case JSR_5:
+
+            record(pc0, pc, XREF_CALL);
+            break;
+
+        case JMP_abs_2:
+        case JMP_abs_ind_4:
+
+            record(pc0, pc, XREF_JUMP);
+            break;
+
+        case BCC_rel_2: case BCS_rel_2: case BEQ_rel_2: case BMI_rel_2:
+        case BNE_rel_2: case BPL_rel_2: case BVC_rel_2: case BVS_rel_2:
+        case branch_3_underflow: case branch_3_overflow:
+
+            record(pc0, pc, XREF_BRANCH);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void
+CrossReferences::compact()
+{
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    compactThreshold = std::max(usize(1) << 20, 2 * edges.size());
+}
+
+void
+CrossReferences::build()
+{
+    std::sort(edges.begin(), edges.end());
+
+    // Merge all references from the same instruction to the same target
+    refs.clear();
+    offsets.assign(65537, 0);
+
+    u64 prev = UINT64_MAX;
+    for (auto key : edges) {
+
+        if ((key >> 8) == prev) {
+
+            refs.back().kind |= u8(key);
+
+        } else {
+
+            refs.push_back(XRef { u16(key >> 8), u8(key) });
+            offsets[(key >> 24) + 1]++;
+            prev = key >> 8;
+        }
+    }
+
+    // Turn the counts into offsets
+    for (isize i = 1; i <= 65536; i++) offsets[i] += offsets[i - 1];
+}
+
+void
+CrossReferences::dump(std::ostream &os, u16 addr) const
+{
+    char line[64];
+
+    for (auto &ref : refsTo(addr)) {
+
+        snprintf(line, sizeof(line), "%04X  %c%c%c%c%c\n", ref.pc,
+                 ref.kind & XREF_READ ? 'r' : '-',
+                 ref.kind & XREF_WRITE ? 'w' : '-',
+                 ref.kind & XREF_JUMP ? 'j' : '-',
+                 ref.kind & XREF_CALL ? 'c' : '-',
+                 ref.kind & XREF_BRANCH ? 'b' : '-');
+        os << line;
+    }
+}
+
+}
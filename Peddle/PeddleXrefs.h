@@ -0,0 +1,159 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include "PeddleTypes.h"
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace peddle {
+
+// Reference kinds
+static constexpr u8 XREF_READ       = 0x01;
+static constexpr u8 XREF_WRITE      = 0x02;
+static constexpr u8 XREF_JUMP       = 0x04;
+static constexpr u8 XREF_CALL       = 0x08;
+static constexpr u8 XREF_BRANCH     = 0x10;
+
+// A single reference to an address
+struct XRef {
+
+    // Address of the referencing instruction
+    u16 pc;
+
+    // Reference kinds (combination of XREF_xxx bits)
+    u8 kind;
+};
+
+/* Cross-reference index
+ *
+ * The index stores, for each address, all instructions referencing it. The
+ * references are collected statically from the control-flow analysis of the
+ * current memory contents, or dynamically while the CPU is running, or both.
+ * Collected references are turned into a compressed sparse row structure by
+ * build(): All references are stored in a single array, sorted by target and
+ * referencing instruction, and an offset table holds the start of each
+ * target's references. Hence, a query costs a table lookup plus the size of
+ * the result. Multiple kinds of references from the same instruction to the
+ * same target are merged into a single entry.
+ *
+ * Static collection uses the base address of indexed operands and the pointer
+ * address of indirect operands, because effective addresses are not known
+ * before run time. Dynamic collection records effective addresses, as well as
+ * taken branches, jumps, and subroutine calls. Fetches, stack accesses, and
+ * dummy reads, e.g., from an indexed address whose high byte hasn't been
+ * fixed yet, are not recorded. Vector fetches are attributed to the
+ * interrupted instruction. A small cache filters out repeated references at
+ * run time.
+ *
+ * If the simple memory API is disabled, the host provides the read and write
+ * functions and is responsible for calling recordAccess() itself.
+ */
+class CrossReferences {
+
+    friend class Peddle;
+
+    // Reference to the connected CPU
+    class Peddle &cpu;
+
+    // Collected references (target << 24 | pc << 8 | kind)
+    std::vector<u64> edges;
+
+    // Recently collected references (filters out repetitions)
+    u64 *recent = nullptr;
+    static constexpr isize recentSize = 4096;
+
+    // The index (offsets has an additional entry marking the end)
+    std::vector<u32> offsets;
+    std::vector<XRef> refs;
+
+    // Indicates whether dynamic collection is enabled
+    bool enabled = false;
+
+
+    //
+    // Initializing
+    //
+
+public:
+
+    CrossReferences(Peddle& ref) : cpu(ref) { }
+    ~CrossReferences();
+
+    void reset();
+
+
+    //
+    // Collecting references
+    //
+
+public:
+
+    // Turns dynamic collection on or off
+    void enable();
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Collects references from the control-flow analysis of the memory contents
+    void collectStatic();
+
+    // Discards all collected references and the index
+    void clear();
+
+    // Records an access performed by the host (ignored while collection is off)
+    void recordAccess(u16 pc, u16 addr, u8 kind) { if (enabled) record(pc, addr, kind); }
+
+private:
+
+    // Records a reference of the current instruction
+    void record(u16 pc, u16 addr, u8 kind) {
+
+        u64 key = u64(addr) << 24 | u64(pc) << 8 | kind;
+        auto &slot = recent[(key * 0x9E3779B97F4A7C15) >> 52];
+
+        if (slot != key) {
+
+            slot = key;
+            edges.push_back(key);
+            if (edges.size() >= compactThreshold) compact();
+        }
+    }
+
+    // Called at the end of each instruction or interrupt sequence
+    void recordInstruction(MicroInstruction last, u16 pc0, u16 pc);
+
+    // Removes duplicate references from the collection
+    void compact();
+    usize compactThreshold = 1 << 20;
+
+
+    //
+    // Building and querying the index
+    //
+
+public:
+
+    // Builds the index from all collected references
+    void build();
+
+    // Returns all references to an address
+    std::span<const XRef> refsTo(u16 addr) const {
+
+        if (offsets.empty()) return { };
+        return { refs.data() + offsets[addr], refs.data() + offsets[addr + 1] };
+    }
+
+    // Returns the total number of references in the index
+    isize count() const { return isize(refs.size()); }
+
+    // Prints all references to an address
+    void dump(std::ostream &os, u16 addr) const;
+};
+
+}
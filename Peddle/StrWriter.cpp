@@ -31,7 +31,7 @@ StrWriter::sprintd(char *&s, u64 value)
 void
 StrWriter::sprintx(char *&s, u64 value, isize digits)
 {
-    char a = (style.numberFormat.upperCase ? 'A' : 'a') - 10;
+    auto table = style.numberFormat.upperCase ? "0123456789ABCDEF" : "0123456789abcdef";
 
     if (value || !style.numberFormat.plainZero) {
 
@@ -40,9 +40,8 @@ StrWriter::sprintx(char *&s, u64 value, isize digits)
     }
     for (isize i = digits - 1; i >= 0; i--) {
 
-        auto digit = char(value % 16);
-        s[i] = (digit <= 9) ? ('0' + digit) : (a + digit);
-        value /= 16;
+        s[i] = table[value & 0xF];
+        value >>= 4;
     }
     s += digits;
 }
@@ -53,6 +52,17 @@ StrWriter::sprintx(char *&s, u64 value)
     sprintx(s, value, hexDigits(value));
 }
 
+bool
+StrWriter::label(u16 addr)
+{
+    if (auto name = symbols ? symbols->lookup(addr) : nullptr) {
+
+        for (isize i = 0; i < SYMBOL_MAX_LENGTH && name[i]; i++) *ptr++ = name[i];
+        return true;
+    }
+    return false;
+}
+
 StrWriter&
 StrWriter::operator<<(char c)
 {
@@ -141,77 +151,87 @@ StrWriter::operator<<(Imm op)
 StrWriter&
 StrWriter::operator<<(Zp op)
 {
-    *this << op.raw;
+    if (!label(op.raw)) *this << op.raw;
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Zpx op)
 {
-    *this << op.raw << ",X";
+    if (!label(op.raw)) *this << op.raw;
+    *this << ",X";
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Zpy op)
 {
-    *this << op.raw << ",Y";
+    if (!label(op.raw)) *this << op.raw;
+    *this << ",Y";
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Abs op)
 {
-    *this << op.raw;
+    if (!label(op.raw)) *this << op.raw;
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Absx op)
 {
-    *this << op.raw << ",X";
+    if (!label(op.raw)) *this << op.raw;
+    *this << ",X";
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Absy op)
 {
-    *this << op.raw << ",Y";
+    if (!label(op.raw)) *this << op.raw;
+    *this << ",Y";
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Ind op)
 {
-    *this << "(" << op.raw << ")";
+    *this << "(";
+    if (!label(op.raw)) *this << op.raw;
+    *this << ")";
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Indx op)
 {
-    *this << "(" << op.raw << ",X)";
+    *this << "(";
+    if (!label(op.raw)) *this << op.raw;
+    *this << ",X)";
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Indy op)
 {
-    *this << "(" << op.raw << "),Y";
+    *this << "(";
+    if (!label(op.raw)) *this << op.raw;
+    *this << "),Y";
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Rel op)
 {
-    *this << op.raw;
+    if (!label(op.raw)) *this << op.raw;
     return *this;
 }
 
 StrWriter&
 StrWriter::operator<<(Dir op)
 {
-    *this << op.raw;
+    if (!label(op.raw)) *this << op.raw;
     return *this;
 }
 
@@ -8,7 +8,7 @@
 #pragma once
 
 #include "Peddle.h"
-#include <cmath>
+#include "PeddleSymbols.h"
 
 namespace peddle {
 
@@ -48,10 +48,12 @@ public:
     char *base;             // Start address of the destination string
     char *ptr;              // Write pointer
     const DasmStyle &style;
+    const SymbolTable *symbols;
 
 public:
 
-    StrWriter(char *p, const DasmStyle &style) : style(style) {
+    StrWriter(char *p, const DasmStyle &style, const SymbolTable *symbols = nullptr) :
+    style(style), symbols(symbols) {
 
         base = ptr = p;
     };
@@ -61,15 +63,18 @@ public:
 
 private:
 
-    isize decDigits(u64 value) { return value ? 1 + (isize)log10(value) : 1; }
-    isize binDigits(u64 value) { return value ? 1 + (isize)log2(value) : 1; }
-    isize hexDigits(u64 value) { return (binDigits(value) + 3) / 4; }
+    isize decDigits(u64 value) { isize d = 1; while (value >= 10) { value /= 10; d++; } return d; }
+    isize binDigits(u64 value) { isize d = 1; while (value >>= 1) d++; return d; }
+    isize hexDigits(u64 value) { isize d = 1; while (value >>= 4) d++; return d; }
 
     void sprintd(char *&s, u64 value, isize digits);
     void sprintd(char *&s, u64 value);
     void sprintx(char *&s, u64 value, isize digits);
     void sprintx(char *&s, u64 value);
 
+    // Writes the label of an address if one exists
+    bool label(u16 addr);
+
 public:
 
     StrWriter& operator<<(char);
@@ -0,0 +1,175 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+/* Fusion test
+ *
+ * Runs random instruction streams on two CPUs, one executing all instructions
+ * cycle by cycle and one with all fusible pairs fused. Both CPUs execute the
+ * same numbers of instructions and must perform the same bus accesses in the
+ * same cycles and end up in the same state. The interrupt lines are driven by
+ * the bus traffic to make interrupts hit fused pairs at arbitrary cycles. In
+ * every other run, traps are set at random addresses.
+ */
+
+#include "Peddle.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace peddle;
+
+// A single bus access
+struct Access {
+
+    char kind;
+    u16 addr;
+    u8 value;
+    i64 cycle;
+
+    bool operator==(const Access &other) const {
+        return kind == other.kind && addr == other.addr && value == other.value && cycle == other.cycle;
+    }
+};
+
+class CPU : public peddle::Peddle {
+
+public:
+
+    u8 ram[65536];
+    std::vector<Access> log;
+    bool irq = false;
+
+    void access(char kind, u16 addr, u8 value)
+    {
+        log.push_back(Access { kind, addr, value, clock++ });
+
+        // Drive the interrupt lines from the bus
+        if (kind == 'W' && (addr & 0x3F) == 0x21) {
+            if ((irq = !irq)) pullDownIrqLine(1); else releaseIrqLine(1);
+        }
+        if (kind == 'W' && (addr & 0xFF) == 0x77) pullDownNmiLine(1);
+        if (kind == 'R' && (addr & 0xFF) == 0x78) releaseNmiLine(1);
+    }
+
+    u8 read(u16 addr) override { access('R', addr, ram[addr]); return ram[addr]; }
+    void write(u16 addr, u8 val) override { access('W', addr, val); ram[addr] = val; }
+    u8 readDasm(u16 addr) const override { return ram[addr]; }
+
+    u16 trapReached(u16 addr, isize id) override
+    {
+        // Modify the state and either run the original code or skip a byte
+        reg.a ^= 0x5A;
+        clock += 2;
+        return id ? addr : u16(addr + 1);
+    }
+};
+
+static u32 seed;
+
+static u32
+nextRandom()
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static bool
+sameState(const CPU &a, const CPU &b)
+{
+    return
+    a.reg.pc == b.reg.pc && a.reg.pc0 == b.reg.pc0 &&
+    a.reg.a == b.reg.a && a.reg.x == b.reg.x && a.reg.y == b.reg.y &&
+    a.reg.sp == b.reg.sp && a.getP() == b.getP() && a.reg.d == b.reg.d &&
+    a.reg.adl == b.reg.adl && a.reg.adh == b.reg.adh && a.reg.ovl == b.reg.ovl &&
+    a.clock == b.clock;
+}
+
+int main(int argc, const char * argv[]) {
+
+    // Instructions without a fast handler, mixed in to break up pairs
+    const u8 others[] = {
+        0x20, 0x60, 0x48, 0x68, 0x08, 0x28, 0xE6, 0xC6,
+        0xEE, 0x58, 0x78, 0x40, 0xB6, 0xA1, 0x81, 0x6C
+    };
+
+    static CPU regular, fused;
+    long instructions = 0;
+
+    for (u32 run = 1; run <= 200; run++) {
+
+        seed = run * 2654435761u;
+
+        // Create a random instruction stream
+        static u8 mem[65536];
+        for (isize i = 0; i < 65536; i++) mem[i] = u8(nextRandom());
+        for (isize i = 0x200; i < 0xFF00; ) {
+
+            u8 opcode;
+            do {
+                opcode = nextRandom() % 5 ? u8(nextRandom()) : others[nextRandom() % sizeof(others)];
+            } while (!Fusion::isFusible(opcode) && !memchr(others, opcode, sizeof(others)));
+
+            mem[i] = opcode;
+            i += regular.getLengthOfInstruction(opcode);
+        }
+        mem[0xFFFC] = 0x00;
+        mem[0xFFFD] = 0x04;
+
+        for (CPU *cpu : { &regular, &fused }) {
+
+            memcpy(cpu->ram, mem, sizeof(mem));
+            cpu->irq = false;
+            cpu->releaseIrqLine(0xFF);
+            cpu->releaseNmiLine(0xFF);
+            cpu->reset();
+            cpu->log.clear();
+        }
+
+        // Set traps
+        for (isize i = 0; run % 2 == 0 && i < 256; i++) {
+
+            auto addr = u16(0x200 + nextRandom() % 0xFD00);
+            auto id = isize(nextRandom() % 2);
+            regular.traps.set(addr, id);
+            fused.traps.set(addr, id);
+        }
+
+        // Fuse all pairs
+        fused.fusion.clear();
+        for (isize i = 0; i < 65536; i++) {
+            if (Fusion::isFusible(u8(i >> 8)) && Fusion::isFusible(u8(i))) fused.fusion.fuse(u8(i >> 8), u8(i));
+        }
+        fused.fusion.enable();
+
+        for (isize step = 0; step < 2000; step++) {
+
+            int count = 1 + nextRandom() % 4;
+            regular.executeInstruction(count);
+            fused.executeInstruction(count);
+            instructions += count;
+
+            if (!sameState(regular, fused)) {
+
+                printf("Run %u, step %ld: State mismatch at %04X / %04X\n",
+                       run, (long)step, regular.reg.pc0, fused.reg.pc0);
+                return 1;
+            }
+            if (regular.log != fused.log) {
+
+                printf("Run %u, step %ld: Bus mismatch at %04X\n", run, (long)step, regular.reg.pc0);
+                return 1;
+            }
+            regular.log.clear();
+            fused.log.clear();
+        }
+    }
+
+    printf("%ld instructions executed without a mismatch\n", instructions);
+    return 0;
+}
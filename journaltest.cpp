@@ -0,0 +1,289 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+/* Journal test
+ *
+ * Runs small programs with the undo journal enabled and takes a snapshot of
+ * the CPU and the memory after each instruction. After stepping back, the CPU
+ * must be in the state of the corresponding snapshot. The programs cover
+ * single and multiple steps, stepping back to a write, wrap-arounds of both
+ * ring buffers, the processor port, the command queue, and trap handlers.
+ */
+
+#include "Peddle.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace peddle;
+
+class CPU : public peddle::Peddle {
+
+public:
+
+    u8 ram[65536];
+
+    // Trap handler configuration
+    u16 resume = 0x0700;
+    isize trapWrites = 1;
+
+    u8 read(u16 addr) override { clock++; return ram[addr]; }
+    void write(u16 addr, u8 val) override { clock++; ram[addr] = val; }
+    u8 readDasm(u16 addr) const override { return ram[addr]; }
+
+    u16 trapReached(u16 addr, isize id) override
+    {
+        // Modify the registers and the memory and continue somewhere else
+        reg.a = 0x42;
+        for (isize i = 0; i < trapWrites; i++) {
+
+            journal.recordWrite(u16(0x10 + i));
+            ram[0x10 + i]++;
+        }
+        return resume ? resume : addr;
+    }
+};
+
+// The state of the CPU at an instruction boundary
+struct State {
+
+    u16 pc;
+    u8 a, x, y, sp, p;
+    u8 direction, data;
+    std::vector<u8> ram;
+};
+
+static CPU cpu;
+static std::vector<State> snapshots;
+static int failures = 0;
+
+static void
+fail(const char *test, const char *msg)
+{
+    printf("%s: %s\n", test, msg);
+    failures++;
+}
+
+static State
+state()
+{
+    return State {
+        cpu.reg.pc, cpu.reg.a, cpu.reg.x, cpu.reg.y, cpu.reg.sp, cpu.getP(),
+        cpu.reg.pport.direction, cpu.reg.pport.data,
+        std::vector<u8>(cpu.ram, cpu.ram + sizeof(cpu.ram))
+    };
+}
+
+// Checks if the CPU is in the state after the n-th instruction
+static void
+check(const char *test, usize n)
+{
+    auto &s = snapshots[n];
+
+    if (cpu.reg.pc != s.pc || cpu.reg.pc0 != s.pc) {
+
+        printf("%s: Expected PC=%04X, got PC=%04X\n", test, s.pc, cpu.reg.pc);
+        failures++;
+    }
+    if (cpu.reg.a != s.a || cpu.reg.x != s.x || cpu.reg.y != s.y ||
+        cpu.reg.sp != s.sp || cpu.getP() != s.p) {
+        fail(test, "Register mismatch");
+    }
+    if (cpu.reg.pport.direction != s.direction || cpu.reg.pport.data != s.data) {
+        fail(test, "Processor port mismatch");
+    }
+    if (memcmp(cpu.ram, s.ram.data(), sizeof(cpu.ram)) != 0) {
+        fail(test, "Memory mismatch");
+    }
+}
+
+// Loads a program and prepares the CPU
+static void
+setup(u16 addr, std::initializer_list<u8> code, isize capacity = 64, CPURevision model = MOS_6502)
+{
+    memset(cpu.ram, 0, sizeof(cpu.ram));
+    memcpy(cpu.ram + addr, code.begin(), code.size());
+
+    cpu.setModel(model);
+    cpu.traps.clear();
+    cpu.commands.disable();
+    cpu.reset();
+    cpu.reg.pc = cpu.reg.pc0 = addr;
+    cpu.resume = 0x0700;
+    cpu.trapWrites = 1;
+    cpu.journal.enable(capacity);
+
+    snapshots.clear();
+}
+
+// Executes n instructions and takes a snapshot before the first and after each
+static void
+run(isize n)
+{
+    if (snapshots.empty()) snapshots.push_back(state());
+
+    for (isize i = 0; i < n; i++) {
+
+        cpu.executeInstruction();
+        snapshots.push_back(state());
+    }
+}
+
+// Steps back n instructions and checks the result
+static void
+stepBack(const char *test, isize n, isize expected)
+{
+    auto undone = cpu.journal.stepBack(n);
+    if (undone != expected) fail(test, "Wrong number of undone instructions");
+
+    snapshots.resize(snapshots.size() - undone);
+    check(test, snapshots.size() - 1);
+}
+
+static const std::initializer_list<u8> program = {
+
+    0xA9, 0x01,         // $0600: LDA #$01
+    0x85, 0x20,         // $0602: STA $20
+    0xA9, 0x02,         // $0604: LDA #$02
+    0x8D, 0x20, 0x00,   // $0606: STA $0020
+    0xEE, 0x20, 0x00,   // $0609: INC $0020
+    0x48,               // $060C: PHA
+    0x20, 0x00, 0x07    // $060D: JSR $0700
+};
+
+static void
+testStepBack()
+{
+    setup(0x0600, program);
+    run(7);
+
+    stepBack("Step back", 1, 1);
+    stepBack("Step back", 2, 2);
+    stepBack("Step back", 10, 4);
+    stepBack("Step back", 1, 0);
+
+    // Redo and undo
+    run(7);
+    stepBack("Step back after redo", 7, 7);
+}
+
+static void
+testStepBackToWrite()
+{
+    setup(0x0600, program);
+    run(7);
+
+    // Undo up to the JSR, which pushes the return address
+    if (!cpu.journal.stepBackToWrite(0x01FF)) fail("Step back to write", "Write not found");
+    snapshots.resize(7);
+    check("Step back to write", 6);
+
+    // Undo up to INC
+    if (!cpu.journal.stepBackToWrite(0x20)) fail("Step back to write", "Write not found");
+    snapshots.resize(5);
+    check("Step back to write", 4);
+
+    // Undo up to STA $0020
+    if (!cpu.journal.stepBackToWrite(0x20)) fail("Step back to write", "Write not found");
+    snapshots.resize(4);
+    check("Step back to write", 3);
+
+    // Addresses that haven't been written must not change anything
+    if (cpu.journal.stepBackToWrite(0x21)) fail("Step back to write", "Unexpected write");
+    check("Step back to write", 3);
+}
+
+static void
+testWrapAround()
+{
+    // $0600: INC $20, JMP $0600
+    setup(0x0600, { 0xE6, 0x20, 0x4C, 0x00, 0x06 }, 4);
+    run(101);
+
+    if (cpu.journal.available() != 4) fail("Wrap around", "Wrong capacity");
+    stepBack("Wrap around", 10, 4);
+
+    // Let a trap handler fill the write buffer
+    setup(0x0600, { 0xE6, 0x20, 0x4C, 0x00, 0x06 }, 4);
+    cpu.traps.set(0x0600);
+    cpu.resume = 0;
+    cpu.trapWrites = 10;
+    run(101);
+
+    stepBack("Wrap around with traps", 10, cpu.journal.available());
+}
+
+static void
+testProcessorPort()
+{
+    setup(0x0600, {
+
+        0xA9, 0x2F,     // $0600: LDA #$2F
+        0x85, 0x00,     // $0602: STA $00
+        0xA9, 0x35,     // $0604: LDA #$35
+        0x8D, 0x01, 0x00 // $0606: STA $0001
+
+    }, 64, MOS_6510);
+    run(4);
+
+    if (cpu.reg.pport.direction != 0x2F || cpu.reg.pport.data != 0x35) {
+        fail("Processor port", "Port not written");
+    }
+    stepBack("Processor port", 1, 1);
+    stepBack("Processor port", 3, 3);
+}
+
+static void
+testCommands()
+{
+    // $0600: LDX #1, $0700: INX
+    setup(0x0600, { 0xA2, 0x01 });
+    cpu.ram[0x0700] = 0xE8;
+    cpu.commands.enable();
+    cpu.commands.put(CMD_JUMP, 0x0700);
+    run(2);
+
+    if (snapshots[1].pc != 0x0700) fail("Commands", "Jump not executed");
+    stepBack("Commands", 1, 1);
+    stepBack("Commands", 1, 1);
+}
+
+static void
+testTrap()
+{
+    // $0600: LDX #1, $0602: NOP (trapped), $0700: INX
+    setup(0x0600, { 0xA2, 0x01, 0xEA });
+    cpu.ram[0x0700] = 0xE8;
+    cpu.ram[0x10] = 0x11;
+    cpu.traps.set(0x0602);
+    run(2);
+
+    if (snapshots[1].pc != 0x0700) fail("Trap", "Trap not handled");
+    stepBack("Trap", 1, 1);
+    stepBack("Trap", 1, 1);
+
+    // Executing the instruction again must trigger the trap again
+    run(1);
+    if (cpu.reg.pc != 0x0700 || cpu.reg.a != 0x42 || cpu.ram[0x10] != 0x12) {
+        fail("Trap", "Trap not handled again");
+    }
+}
+
+int main(int argc, const char * argv[]) {
+
+    testStepBack();
+    testStepBackToWrite();
+    testWrapAround();
+    testProcessorPort();
+    testCommands();
+    testTrap();
+
+    if (failures) return 1;
+
+    printf("All journal tests passed\n");
+    return 0;
+}
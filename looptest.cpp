@@ -0,0 +1,180 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+/* Loop acceleration test
+ *
+ * Creates random copy and fill loops and runs each of them on two CPUs, one
+ * executing all iterations cycle by cycle and one with loop acceleration
+ * enabled. The loops vary in the index register, the counting direction, the
+ * addressing modes, and the distance between source, destination, and code,
+ * including overlapping and wrapping transfers. Some runs start with a pending
+ * interrupt, leave an I/O area unmapped, or set traps inside or behind the
+ * loop. After the loop, both CPUs must agree on the memory, the registers,
+ * and the clock.
+ */
+
+#include "Peddle.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace peddle;
+
+class CPU : public peddle::Peddle {
+
+public:
+
+    u8 ram[65536];
+
+    u8 read(u16 addr) override { clock++; return ram[addr]; }
+    void write(u16 addr, u8 val) override { clock++; ram[addr] = val; }
+    u8 readDasm(u16 addr) const override { return ram[addr]; }
+
+    u16 trapReached(u16 addr, isize id) override
+    {
+        reg.a ^= 0x5A;
+        clock += 2;
+        return addr;
+    }
+};
+
+static u32 seed;
+
+static u32
+nextRandom()
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static bool
+sameState(const CPU &a, const CPU &b)
+{
+    return
+    a.reg.pc == b.reg.pc && a.reg.pc0 == b.reg.pc0 &&
+    a.reg.a == b.reg.a && a.reg.x == b.reg.x && a.reg.y == b.reg.y &&
+    a.reg.sp == b.reg.sp && a.getP() == b.getP() && a.reg.d == b.reg.d &&
+    a.reg.adl == b.reg.adl && a.reg.adh == b.reg.adh && a.reg.ovl == b.reg.ovl &&
+    a.reg.idl == b.reg.idl && a.clock == b.clock &&
+    memcmp(a.ram, b.ram, sizeof(a.ram)) == 0;
+}
+
+int main(int argc, const char * argv[]) {
+
+    static CPU regular, accelerated;
+    static u8 mem[65536];
+    long loops = 0;
+
+    for (u32 run = 1; run <= 20000; run++) {
+
+        seed = run * 2654435761u;
+
+        for (isize i = 0; i < 65536; i++) mem[i] = u8(nextRandom());
+
+        // Choose the loop layout
+        u16 start = u16(0x200 + nextRandom() % 0xFD00);
+        bool x = nextRandom() % 2, load = nextRandom() % 3, up = nextRandom() % 2;
+        bool indirectLoad = !x && nextRandom() % 2, indirectStore = !x && nextRandom() % 2;
+        u16 src = u16(nextRandom()), dst = u16(nextRandom());
+        u8 zpLoad = u8(nextRandom()), zpStore = u8(nextRandom());
+
+        switch (nextRandom() % 4) {
+
+            case 0: dst = u16(src + nextRandom() % 5 - 2); break;   // Overlapping
+            case 1: dst = u16(start - nextRandom() % 300); break;   // Close to the code
+            case 2: src = u16(0xFF00 + nextRandom() % 256); break;  // Wrapping around
+        }
+        if (nextRandom() % 4) { zpLoad |= 2; zpStore |= 2; }
+
+        // Assemble the loop
+        u16 pc = start;
+        auto put = [&](u8 value) { mem[pc++] = value; };
+
+        if (load && indirectLoad) {
+
+            put(0xB1); put(zpLoad);
+            mem[zpLoad] = LO_BYTE(src);
+            mem[u8(zpLoad + 1)] = HI_BYTE(src);
+
+        } else if (load) {
+
+            put(x ? 0xBD : 0xB9); put(LO_BYTE(src)); put(HI_BYTE(src));
+        }
+        if (indirectStore) {
+
+            put(0x91); put(zpStore);
+            mem[zpStore] = LO_BYTE(dst);
+            mem[u8(zpStore + 1)] = HI_BYTE(dst);
+
+        } else {
+
+            put(x ? 0x9D : 0x99); put(LO_BYTE(dst)); put(HI_BYTE(dst));
+        }
+        put(x ? (up ? 0xE8 : 0xCA) : (up ? 0xC8 : 0x88));
+        put(0xD0); put(u8(start - (pc + 1)));
+        u16 end = pc;
+
+        // Initialize both CPUs
+        u8 a = u8(nextRandom()), xr = u8(nextRandom()), yr = u8(nextRandom()), p = u8(nextRandom());
+        bool irq = nextRandom() % 8 == 0;
+
+        for (CPU *cpu : { &regular, &accelerated }) {
+
+            cpu->setModel(run % 2 ? MOS_6510 : MOS_6502);
+            memcpy(cpu->ram, mem, sizeof(mem));
+            cpu->releaseIrqLine(0xFF);
+            cpu->releaseNmiLine(0xFF);
+            cpu->reset();
+            cpu->reg.pc = cpu->reg.pc0 = start;
+            cpu->reg.a = a;
+            cpu->reg.x = xr;
+            cpu->reg.y = yr;
+            cpu->setP(p);
+            if (irq) cpu->pullDownIrqLine(1);
+
+            cpu->traps.clear();
+            if (run % 4 == 1) cpu->traps.set(end);
+            if (run % 8 == 2) cpu->traps.set(u16(start + 3));
+        }
+
+        // Declare plain memory (leaving an I/O area unmapped in some runs)
+        accelerated.loops.unmapAll();
+        accelerated.loops.map(0, 256, accelerated.ram);
+        if (run % 3 == 0) accelerated.loops.unmap(0xD0, 16);
+        accelerated.loops.enable();
+
+        // Run both CPUs until they leave the loop
+        auto count = accelerated.loops.acceleratedLoops();
+
+        for (isize i = 0; i < 3000 && regular.reg.pc0 != end; i++) regular.executeInstruction();
+        for (isize i = 0; i < 3000 && accelerated.reg.pc0 != end; i++) accelerated.executeInstruction();
+
+        bool native = accelerated.loops.acceleratedLoops() != count;
+        loops += native;
+
+        if (regular.reg.pc0 != end) {
+
+            // The loop doesn't terminate (e.g., because it overwrites itself)
+            if (native) {
+
+                printf("Run %u: Accelerated a loop that doesn't terminate\n", run);
+                return 1;
+            }
+            continue;
+        }
+        if (!sameState(regular, accelerated)) {
+
+            printf("Run %u: Mismatch after the loop at %04X (%s)\n",
+                   run, start, native ? "accelerated" : "not accelerated");
+            return 1;
+        }
+    }
+
+    printf("%ld of 20000 loops accelerated without a mismatch\n", loops);
+    return 0;
+}
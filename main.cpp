@@ -7,7 +7,10 @@
 
 #include "Peddle.h"
 #include <iostream>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 using namespace peddle;
 
@@ -39,7 +42,7 @@ public:
 
     void dump()
     {
-        char instr[64];
+        char instr[DASM_MAX_INSTR];
         (void)disassembler.disassemble(instr, getPC0());
 
         printf("%04X %02X %02X %02X %02X %02X  %d%d1%d%d%d%d%d %-15s",
@@ -54,6 +57,53 @@ public:
     }
 };
 
+// Runs the test program repeatedly and returns the elapsed time in seconds
+double run(CPU &cpu, long rounds) {
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (long i = 0; i < rounds; i++) {
+
+        cpu.reg.pc = cpu.reg.pc0 = 0x600;
+        while (ram[cpu.getPC0()]) cpu.executeInstruction();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Compares the execution speed with and without instruction fusion
+int benchmark(CPU &cpu, long rounds) {
+
+    // Profile a single run to count instructions and to select the fused pairs
+    cpu.stats.enable();
+    cpu.stats.trackPairs(true);
+    run(cpu, 1);
+    cpu.stats.disable();
+
+    auto instructions = double(cpu.stats.instructions()) * double(rounds);
+    cpu.fusion.select();
+
+    printf("Fused pairs:\n\n");
+    cpu.fusion.dump(std::cout);
+
+    auto regular = run(cpu, rounds);
+    cpu.fusion.enable();
+
+    if (cpu.fusion.isSuspended()) {
+        printf("\nWarning: Fusion is suspended by an active debugging or monitoring feature\n");
+    }
+    auto fused = run(cpu, rounds);
+    cpu.fusion.disable();
+
+    printf("\n%ld runs, %.0f instructions\n\n", rounds, instructions);
+    printf("Regular: %8.3f s %8.2f ns/instruction\n", regular, regular * 1e9 / instructions);
+    printf("Fused:   %8.3f s %8.2f ns/instruction\n", fused, fused * 1e9 / instructions);
+    printf("Speedup: %8.2fx\n", regular / fused);
+
+    return 0;
+}
+
 int main(int argc, const char * argv[]) {
 
     CPU cpu;
@@ -68,6 +118,12 @@ int main(int argc, const char * argv[]) {
     // Reset the CPU
     cpu.reset();
 
+    // Run the benchmark if requested (main --bench [runs])
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+
+        return benchmark(cpu, argc > 2 ? atol(argv[2]) : 1000000);
+    }
+
     printf("Peddle - A MOS Technology 65xx CPU emulator\n\n");
     printf("Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de\n");
     printf("Published under the terms of the MIT License\n\n");
@@ -77,7 +133,7 @@ int main(int argc, const char * argv[]) {
 
     // Disassemble the program
     u16 len;
-    char instr[64], bytes[64];
+    char instr[DASM_MAX_INSTR], bytes[64];
     for (u16 addr = 0x600; addr < 0x600 + sizeof(prog); addr += len) {
 
         len = (u16)cpu.disassembler.disassemble(instr, addr);
@@ -0,0 +1,162 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+#include "Peddle.h"
+#include "PeddleTraceIndex.h"
+#include "PeddleTraceFormatter.h"
+#include "PeddleColumns.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <cstdio>
+
+using namespace peddle;
+
+static void
+usage()
+{
+    printf("Usage: tracequery <trace> <command> [arguments]\n\n");
+    printf("Commands:\n\n");
+    printf("    info                      Prints information about the trace\n");
+    printf("    index                     Saves an index next to the trace\n");
+    printf("    exec  <pc>   [from] [to]  Lists all executions of an instruction\n");
+    printf("    read  <addr> [from] [to]  Lists all reads from an address\n");
+    printf("    write <addr> [from] [to]  Lists all writes to an address\n");
+    printf("    sp    <cycle>             Shows the last instruction that changed SP\n");
+    printf("    text  [format]            Converts the whole trace to text\n");
+    printf("    columns <file>            Converts the whole trace to columnar format\n\n");
+    printf("Addresses are specified in hexadecimal, cycles in decimal.\n");
+    printf("Queries use the saved index if present and build one otherwise.\n");
+    printf("Formats use the control sequences of Disassembler::disass().\n");
+}
+
+static u16
+parseAddr(const char *str)
+{
+    if (str[0] == '$') str++;
+    return u16(std::stoul(str, nullptr, 16));
+}
+
+static u64
+parseCycle(const char *str)
+{
+    return std::stoull(str, nullptr, 10);
+}
+
+int main(int argc, const char * argv[]) {
+
+    if (argc < 3) { usage(); return 1; }
+
+    std::ifstream stream(argv[1], std::ios::binary);
+    if (!stream) { fprintf(stderr, "Cannot open %s\n", argv[1]); return 1; }
+
+    // The disassembler requires an (otherwise unused) CPU instance
+    Peddle cpu;
+
+    try {
+
+        TraceDecoder trace(stream);
+        std::string cmd = argv[2];
+
+        auto format = Disassembler::compile("%p  %9b  %12i A=%a X=%x Y=%y SP=%s %f");
+
+        auto print = [&](u64 nr, const RecordedInstruction &instr) {
+
+            char line[128];
+            cpu.disassembler.disass(line, format, instr);
+            printf("%10llu %12llu  %s\n", (unsigned long long)nr, (unsigned long long)instr.cycle, line);
+        };
+
+        if (cmd == "info") {
+
+            printf("Records: %llu\n", (unsigned long long)trace.count());
+            printf(" Blocks: %zu\n", trace.getIndex().size());
+            return 0;
+        }
+
+        if (cmd == "text" && argc <= 4) {
+
+            auto fmt = argc == 4 ? argv[3] : "%12c %p  %9b  %12i A=%a X=%x Y=%y SP=%s %f";
+            TraceFormatter formatter(cpu.disassembler, std::cout, fmt);
+
+            RecordedInstruction instr;
+            while (trace.next(instr)) formatter << instr;
+            return 0;
+        }
+
+        if (cmd == "columns" && argc == 4) {
+
+            std::ofstream out(argv[3], std::ios::binary);
+            if (!out) { fprintf(stderr, "Cannot create %s\n", argv[3]); return 1; }
+
+            ColumnWriter writer(out);
+
+            RecordedInstruction instr;
+            while (trace.next(instr)) writer << instr;
+            writer.finish();
+
+            printf("Records: %llu\n", (unsigned long long)writer.count());
+            return 0;
+        }
+
+        auto indexPath = TraceIndex::pathFor(argv[1]);
+
+        if (cmd == "index" && argc == 3) {
+
+            TraceIndex index(trace);
+
+            std::ofstream out(indexPath, std::ios::binary);
+            if (!out) { fprintf(stderr, "Cannot create %s\n", indexPath.c_str()); return 1; }
+
+            index.save(out);
+            printf("Saved %s\n", indexPath.c_str());
+            return 0;
+        }
+
+        // Load the saved index or build a new one
+        std::unique_ptr<TraceIndex> saved;
+        if (std::ifstream(indexPath).good()) {
+
+            try {
+                saved = std::make_unique<TraceIndex>(trace, indexPath);
+            } catch (std::exception &e) {
+                fprintf(stderr, "Ignoring the saved index: %s\n", e.what());
+            }
+        }
+        if (!saved) saved = std::make_unique<TraceIndex>(trace);
+        auto &index = *saved;
+
+        if (cmd == "sp" && argc == 4) {
+
+            auto nr = index.lastSPChange(parseCycle(argv[3]));
+            if (nr >= 0) print(u64(nr), index.record(u64(nr)));
+            return 0;
+        }
+
+        if ((cmd == "exec" || cmd == "read" || cmd == "write") && argc >= 4 && argc <= 6) {
+
+            auto addr = parseAddr(argv[3]);
+            auto from = argc > 4 ? parseCycle(argv[4]) : 0;
+            auto to = argc > 5 ? parseCycle(argv[5]) : UINT64_MAX;
+
+            auto result =
+            cmd == "exec" ? index.executions(addr, from, to) :
+            cmd == "read" ? index.readsFrom(addr, from, to) : index.writesTo(addr, from, to);
+
+            for (auto nr : result) print(nr, index.record(nr));
+            return 0;
+        }
+
+    } catch (std::exception &e) {
+
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,263 @@
+// -----------------------------------------------------------------------------
+// This file is part of Peddle - A MOS 65xx CPU emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+/* Trace codec test
+ *
+ * Encodes random traces with different block sizes and checks that decoding
+ * yields the original records, that seeking by cycle and by record number
+ * agrees with a linear search, that saved indices answer queries like freshly
+ * built ones, and that truncated traces and decreasing cycles are rejected.
+ */
+
+#include "PeddleTraceIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace peddle;
+
+static u32 seed;
+
+static u32
+nextRandom()
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static bool
+operator==(const RecordedInstruction &a, const RecordedInstruction &b)
+{
+    return
+    a.cycle == b.cycle && a.pc == b.pc &&
+    a.byte1 == b.byte1 && a.byte2 == b.byte2 && a.byte3 == b.byte3 &&
+    a.sp == b.sp && a.a == b.a && a.x == b.x && a.y == b.y && a.flags == b.flags;
+}
+
+// Creates a trace with runs of similar records and occasional jumps
+static std::vector<RecordedInstruction>
+createTrace(isize count)
+{
+    std::vector<RecordedInstruction> result;
+    RecordedInstruction instr = { };
+
+    for (isize i = 0; i < count; i++) {
+
+        auto r = nextRandom();
+
+        instr.cycle += r % 16 == 0 ? nextRandom() : r % 8;
+        instr.pc = r % 32 == 0 ? u16(nextRandom()) : u16(instr.pc + r % 4);
+        if (r & 0x100) instr.byte1 = u8(nextRandom());
+        if (r & 0x200) instr.byte2 = u8(nextRandom());
+        if (r & 0x400) instr.byte3 = u8(nextRandom());
+        if (r & 0x800) instr.sp = u8(nextRandom());
+        if (r & 0x1000) instr.a = u8(nextRandom());
+        if (r & 0x2000) instr.x = u8(nextRandom());
+        if (r & 0x4000) instr.y = u8(nextRandom());
+        if (r & 0x8000) instr.flags = u8(nextRandom());
+
+        result.push_back(instr);
+    }
+    return result;
+}
+
+static std::string
+encode(const std::vector<RecordedInstruction> &trace, isize blockSize)
+{
+    std::ostringstream os;
+    TraceEncoder encoder(os, blockSize);
+
+    for (auto &instr : trace) encoder << instr;
+    encoder.finish();
+
+    return os.str();
+}
+
+// Compares the decoded records, starting with the decoder's current position
+static bool
+matches(TraceDecoder &decoder, const std::vector<RecordedInstruction> &trace, isize count)
+{
+    RecordedInstruction instr;
+
+    for (u64 nr = decoder.tell(); count--; nr++) {
+
+        if (nr == trace.size()) return !decoder.next(instr);
+        if (!decoder.next(instr) || !(instr == trace[nr])) return false;
+    }
+    return true;
+}
+
+static bool
+testRoundTrip(const std::vector<RecordedInstruction> &trace, const std::string &file)
+{
+    // Decode from memory
+    TraceDecoder decoder((const u8 *)file.data(), file.size());
+    if (decoder.count() != trace.size() || !matches(decoder, trace, isize(trace.size()) + 1)) {
+        return false;
+    }
+
+    // Decode from a stream
+    std::istringstream is(file);
+    TraceDecoder streamDecoder(is);
+    return streamDecoder.count() == trace.size() && matches(streamDecoder, trace, isize(trace.size()) + 1);
+}
+
+static bool
+testSeek(const std::vector<RecordedInstruction> &trace, const std::string &file)
+{
+    TraceDecoder decoder((const u8 *)file.data(), file.size());
+
+    for (isize i = 0; i < 200; i++) {
+
+        // Seek by cycle (including cycles before the first and behind the last record)
+        u64 cycle = trace.empty() ? 0 : trace[nextRandom() % trace.size()].cycle;
+        if (i % 3 == 1) cycle++;
+        if (i == 0) cycle = 0;
+        if (i == 1) cycle = UINT64_MAX;
+
+        u64 expected = 0;
+        while (expected < trace.size() && trace[expected].cycle < cycle) expected++;
+
+        decoder.seek(cycle);
+        if (decoder.tell() != expected || !matches(decoder, trace, 3)) return false;
+
+        // Seek by record number
+        u64 nr = trace.empty() ? 0 : nextRandom() % trace.size();
+
+        decoder.seekRecord(nr);
+        if (decoder.tell() != nr || !matches(decoder, trace, 3)) return false;
+    }
+    return true;
+}
+
+static bool
+testTruncation(const std::string &file)
+{
+    for (usize size = 0; size < file.size(); size++) {
+
+        try {
+            TraceDecoder decoder((const u8 *)file.data(), size);
+            return false;
+        } catch (const std::runtime_error &) { }
+    }
+    return true;
+}
+
+static void
+save(const TraceIndex &index, const char *path)
+{
+    std::ofstream os(path, std::ios::binary);
+    index.save(os);
+}
+
+static bool
+testSavedIndex(const std::vector<RecordedInstruction> &trace, const std::string &file)
+{
+    TraceDecoder decoder((const u8 *)file.data(), file.size());
+    TraceIndex built(decoder);
+
+    save(built, "tracetest.idx");
+    TraceIndex loaded(decoder, "tracetest.idx");
+    std::remove("tracetest.idx");
+
+    auto same = [](std::span<const u32> a, std::span<const u32> b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    };
+
+    for (isize i = 0; i < 200; i++) {
+
+        auto addr = u16(nextRandom());
+        auto from = trace.empty() ? 0 : trace[nextRandom() % trace.size()].cycle;
+
+        if (!same(built.executions(addr, from), loaded.executions(addr, from)) ||
+            !same(built.readsFrom(addr, from), loaded.readsFrom(addr, from)) ||
+            !same(built.writesTo(addr, from), loaded.writesTo(addr, from)) ||
+            built.lastSPChange(from) != loaded.lastSPChange(from)) return false;
+    }
+
+    // An index must not be loaded for a different trace
+    auto other = encode(createTrace(10), 4096);
+    TraceDecoder otherDecoder((const u8 *)other.data(), other.size());
+
+    save(built, "tracetest.idx");
+    try {
+        TraceIndex mismatch(otherDecoder, "tracetest.idx");
+        std::remove("tracetest.idx");
+        return false;
+    } catch (const std::runtime_error &) { }
+
+    std::remove("tracetest.idx");
+    return true;
+}
+
+static bool
+testDecreasingCycles()
+{
+    std::ostringstream os;
+    TraceEncoder encoder(os);
+
+    encoder << RecordedInstruction { .cycle = 100 };
+    try {
+        encoder << RecordedInstruction { .cycle = 99 };
+        return false;
+    } catch (const std::runtime_error &) { }
+
+    return true;
+}
+
+int main(int argc, const char * argv[]) {
+
+    const isize sizes[] = { 0, 1, 2, 100, 5000 };
+    const isize blockSizes[] = { 1, 2, 7, 64, 4096 };
+
+    seed = 2654435761u;
+
+    for (auto size : sizes) {
+
+        auto trace = createTrace(size);
+
+        for (auto blockSize : blockSizes) {
+
+            auto file = encode(trace, blockSize);
+
+            if (!testRoundTrip(trace, file)) {
+
+                printf("Round trip failed (%ld records, block size %ld)\n", (long)size, (long)blockSize);
+                return 1;
+            }
+            if (!testSeek(trace, file)) {
+
+                printf("Seek failed (%ld records, block size %ld)\n", (long)size, (long)blockSize);
+                return 1;
+            }
+            if (blockSize == 64 && !testSavedIndex(trace, file)) {
+
+                printf("Saved index mismatch (%ld records)\n", (long)size);
+                return 1;
+            }
+            if (size <= 100 && !testTruncation(file)) {
+
+                printf("Truncated trace accepted (%ld records, block size %ld)\n", (long)size, (long)blockSize);
+                return 1;
+            }
+        }
+    }
+
+    if (!testDecreasingCycles()) {
+
+        printf("Decreasing cycles accepted\n");
+        return 1;
+    }
+
+    printf("All trace codec tests passed\n");
+    return 0;
+}